@@ -6,7 +6,31 @@ set -euo pipefail
 #
 # Usage:
 #   ./cli.sh <fixture.json>                    Single-transaction mode
-#   ./cli.sh --block <blk.dat> <rev.dat> <xor.dat>   Block mode
+#   ./cli.sh --block <blk.dat> <rev.dat> <xor.dat> [--threads N]   Block mode
+#   ./cli.sh --block-all <blk.dat> <rev.dat> <xor.dat>   Full-file block mode
+#   ./cli.sh --blocks-dir <dir> [--threads N]        Blocks-directory mode
+#   ./cli.sh --block-at <blk.dat> <rev.dat> <xor.dat> <blk-offset> <rev-offset>
+#   ./cli.sh --block-at <blk.dat> <rev.dat> <xor.dat> <block-hash> --index <file>
+#                                                    Random-access block mode
+#   ./cli.sh --build-index <blk.dat> <rev.dat> <xor.dat> <index-file>
+#                                                    Offset sidecar for --block-at
+#   ./cli.sh --block-summary <blk.dat> <xor.dat> <blk-offset|block-hash --index <file>> [--txid <txid>]
+#                                                    Block summary mode
+#   ./cli.sh --follow <dir> [--max-blocks N]         Live follow mode
+#   ./cli.sh --headers-only <dir|blk.dat> [--threads N]  Header chain mode
+#
+# Block options (block, full-file and blocks-directory modes):
+#   --io-uring        Read the files with io_uring instead of mmap, falls back
+#                     to plain reads where io_uring is unavailable
+#   --direct          Read the files with O_DIRECT (or drop them from the page
+#                     cache right after reading), so scanning a live datadir
+#                     does not evict the node's hot pages. The blk file is
+#                     streamed through an 8 MiB buffer; the rev file is held
+#                     in memory whole (up to ~20 MiB per file)
+#   --queue-depth N   Reads kept in flight with --io-uring (default 8)
+#
+# The [summary] line on stderr reports bytes_read and how much of the blk/rev
+# files was in the page cache before and after the run (cached_before/after).
 #
 # Transaction mode:
 #   - Reads the fixture JSON (raw_tx + prevouts)
@@ -19,7 +43,50 @@ set -euo pipefail
 #   - Reads blk*.dat, rev*.dat, and xor.dat
 #   - Parses all blocks and transactions
 #   - Writes JSON report per block to out/<block_hash>.json
+#   - Decodes the block's transactions on N threads (default: all cores)
 #   - Exits 0 on success, 1 on error
+#
+# Full-file block mode:
+#   - Same inputs as block mode
+#   - Walks every record of the blk/rev files in one pass
+#   - Writes one JSON report per block to out/<block_hash>.json
+#   - Prints progress counters to stderr
+#
+# In block and full-file block mode <blk.dat> may be "-" to stream the blk
+# file from stdin (e.g. zstd -dc blk.zst | ./cli.sh --block - rev.dat xor.dat),
+# memory then stays at about one block whatever the file size
+#
+# Blocks-directory mode:
+#   - Finds every blkNNNNN.dat/revNNNNN.dat pair (and xor.dat) in <dir>
+#   - Parses the file pairs on N worker threads (default: all cores)
+#   - Writes one JSON report per block to out/<block_hash>.json
+#   - With --io-uring each worker reads its next file pair while parsing
+#
+# Random-access block mode:
+#   - Reads only the blk and rev records at the given offsets (or the offsets
+#     of <block-hash> in a sidecar written by --build-index)
+#   - Writes the JSON report of that one block to out/<block_hash>.json
+#   - Decodes the block's transactions on all cores
+#
+# Block summary mode:
+#   - Reads only the blk record at <blk-offset> (or the offset of <block-hash>
+#     in a sidecar written by --build-index); no rev file is needed
+#   - Prints the header, tx count and coinbase (txid, BIP34 height, output
+#     total) to stdout, plus the index of <txid> in the block if given
+#   - Decodes only the coinbase and the transactions it has to look at
+#
+# Header chain mode:
+#   - Reads only the record prefix, 80-byte header and tx count of every
+#     block in every blk file, skipping the transactions
+#   - Prints one JSON line per block to stdout (header fields, block hash,
+#     height if the chain reaches genesis, file and offset)
+#   - Prints the chain tip and its height to stderr
+#
+# Live follow mode:
+#   - Watches a bitcoind blocks directory (inotify) as new blocks are appended
+#   - Writes out/<block_hash>.json once a block and its undo data are complete
+#   - Records still being written are retried on the next change
+#   - Runs until interrupted, or until N reports were written
 ###############################################################################
 
 error_json() {
@@ -31,11 +98,86 @@ error_json() {
 SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
 BIN="$SCRIPT_DIR/src/build/tx_tool"
 
+# --- Blocks-directory / live follow mode ---
+if [[ "${1:-}" == "--blocks-dir" || "${1:-}" == "--follow" ]]; then
+  MODE="$1"
+  shift
+  if [[ $# -lt 1 ]]; then
+    error_json "INVALID_ARGS" "$MODE requires a blocks directory: $MODE <dir> [options]"
+    echo "Error: $MODE requires a directory argument" >&2
+    exit 1
+  fi
+
+  if [[ ! -d "$1" ]]; then
+    error_json "FILE_NOT_FOUND" "Directory not found: $1"
+    echo "Error: Directory not found: $1" >&2
+    exit 1
+  fi
+
+  mkdir -p out
+  exec "$BIN" "$MODE" "$@"
+fi
+
+# --- Header chain mode ---
+if [[ "${1:-}" == "--headers-only" ]]; then
+  shift
+  if [[ $# -lt 1 || ! -e "$1" ]]; then
+    error_json "FILE_NOT_FOUND" "Header chain mode requires an existing blocks directory or blk file"
+    echo "Error: --headers-only requires an existing <dir|blk.dat>" >&2
+    exit 1
+  fi
+
+  exec "$BIN" --headers-only "$@"
+fi
+
+# --- Random-access block mode / offset sidecar ---
+if [[ "${1:-}" == "--block-at" || "${1:-}" == "--build-index" ]]; then
+  MODE="$1"
+  shift
+  if [[ $# -lt 4 ]]; then
+    error_json "INVALID_ARGS" "$MODE requires: <blk.dat> <rev.dat> <xor.dat> and offsets, a block hash or an index file"
+    echo "Error: $MODE requires at least 4 arguments" >&2
+    exit 1
+  fi
+
+  for f in "$1" "$2" "$3"; do
+    if [[ ! -f "$f" ]]; then
+      error_json "FILE_NOT_FOUND" "File not found: $f"
+      echo "Error: File not found: $f" >&2
+      exit 1
+    fi
+  done
+
+  mkdir -p out
+  exec "$BIN" "$MODE" "$@"
+fi
+
+# --- Block summary mode ---
+if [[ "${1:-}" == "--block-summary" ]]; then
+  shift
+  if [[ $# -lt 3 ]]; then
+    error_json "INVALID_ARGS" "--block-summary requires: <blk.dat> <xor.dat> and an offset or a block hash"
+    echo "Error: --block-summary requires at least 3 arguments" >&2
+    exit 1
+  fi
+
+  for f in "$1" "$2"; do
+    if [[ ! -f "$f" ]]; then
+      error_json "FILE_NOT_FOUND" "File not found: $f"
+      echo "Error: File not found: $f" >&2
+      exit 1
+    fi
+  done
+
+  exec "$BIN" --block-summary "$@"
+fi
+
 # --- Block mode ---
-if [[ "${1:-}" == "--block" ]]; then
+if [[ "${1:-}" == "--block" || "${1:-}" == "--block-all" ]]; then
+  MODE="$1"
   shift
   if [[ $# -lt 3 ]]; then
-    error_json "INVALID_ARGS" "Block mode requires: --block <blk.dat> <rev.dat> <xor.dat>"
+    error_json "INVALID_ARGS" "Block mode requires: $MODE <blk.dat> <rev.dat> <xor.dat>"
     echo "Error: Block mode requires 3 file arguments: <blk.dat> <rev.dat> <xor.dat>" >&2
     exit 1
   fi
@@ -43,8 +185,13 @@ if [[ "${1:-}" == "--block" ]]; then
   BLK_FILE="$1"
   REV_FILE="$2"
   XOR_FILE="$3"
+  shift 3
 
+  # "-" (or a pipe) streams the blk file, e.g. zstd -dc blk.zst | cli.sh --block - ...
   for f in "$BLK_FILE" "$REV_FILE" "$XOR_FILE"; do
+    if [[ "$f" == "$BLK_FILE" && ( "$f" == "-" || -p "$f" ) ]]; then
+      continue
+    fi
     if [[ ! -f "$f" ]]; then
       error_json "FILE_NOT_FOUND" "File not found: $f"
       echo "Error: File not found: $f" >&2
@@ -56,7 +203,7 @@ if [[ "${1:-}" == "--block" ]]; then
   mkdir -p out
 
   # Delegate actual parsing to C++ binary
-  exec "$BIN" --block "$BLK_FILE" "$REV_FILE" "$XOR_FILE"
+  exec "$BIN" "$MODE" "$BLK_FILE" "$REV_FILE" "$XOR_FILE" "$@"
 fi
 
 # --- Single-transaction mode ---
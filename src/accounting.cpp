@@ -14,37 +14,75 @@ InputTxnWithPrevout::InputTxnWithPrevout(const std::string &filepath)
 
 TxnAnalyzer::TxnAnalyzer(
     const Transaction &tx,
-    const std::vector<Prevout> &prevouts,
-    const std::string &network)
-    : tx_(tx), network_(network)
+    std::span<const Prevout> prevouts,
+    const std::string &network,
+    std::pmr::memory_resource *mr)
+    : network_(network), mr_(mr), inputs_(mr), outputs_(mr), warnings_(mr)
 {
+    analyze(tx, prevouts, {});
+}
+
+TxnAnalyzer::TxnAnalyzer(
+    const TransactionView &tx,
+    std::span<const uint8_t> output_types,
+    std::span<const Prevout> prevouts,
+    const std::string &network,
+    std::pmr::memory_resource *mr)
+    : network_(network), mr_(mr), inputs_(mr), outputs_(mr), warnings_(mr)
+{
+    analyze(tx, prevouts, output_types);
+}
+
+template <typename Tx>
+void TxnAnalyzer::analyze(const Tx &tx, std::span<const Prevout> prevouts,
+                          std::span<const uint8_t> output_types)
+{
+    segwit_        = tx.is_segwit();
+    txid_          = tx.get_txid();
+    wtxid_         = tx.get_wtxid();
+    version_       = tx.version;
+    locktime_      = tx.locktime;
+    size_bytes_    = tx.get_size_bytes();
+    weight_        = tx.get_weight();
+    vbytes_        = tx.get_vbytes();
+    rbf_           = tx.RBF_enabled();
+    locktime_type_ = tx.get_locktime_type();
+
     // Build prevout lookup map: "txid_hex:vout" → Prevout*
-    std::unordered_map<std::string, const Prevout *> prevout_map;
+    PrevoutMap prevout_map(mr_);
+    prevout_map.reserve(prevouts.size());
     for (const Prevout &p : prevouts)
     {
-        std::string key = bytes_to_hex(p.txid) + ":" + std::to_string(p.vout);
+        std::pmr::string key = bytes_to_hex(p.txid, mr_);
+        key += ':';
+        key += std::to_string(p.vout);
         if (prevout_map.count(key))
-            throw std::runtime_error("Duplicate prevout in fixture: " + key);
-        prevout_map[key] = &p;
+            throw std::runtime_error("Duplicate prevout in fixture: " + std::string(key));
+        prevout_map.emplace(std::move(key), &p);
     }
 
     // inputs first (fee needs input sats), then fee, then rest
-    build_inputs(prevout_map);
-    build_outputs();
+    build_inputs(tx, prevout_map);
+    build_outputs(tx, output_types);
     build_fee_info();
     build_segwit_savings();
     build_warnings();
 }
 
-void TxnAnalyzer::build_inputs(
-    const std::unordered_map<std::string, const Prevout *> &prevout_map)
+template <typename Tx>
+void TxnAnalyzer::build_inputs(const Tx &tx, const PrevoutMap &prevout_map)
 {
-    for (const TxIn &in : tx_.inputs)
+    inputs_.reserve(tx.inputs.size());
+
+    // Decompressed prevout script, reused for every input
+    Script prevout_script(mr_);
+
+    for (const auto &in : tx.inputs)
     {
-        AccountedInput ai;
+        AccountedInput ai(mr_);
 
         std::array<uint8_t, 32> rev = reverse_32(in.prevTxId);
-        ai.txid     = bytes_to_hex(rev);
+        ai.txid     = bytes_to_hex(rev, mr_);
         ai.vout     = in.vout;
         ai.sequence = in.sequence;
         ai.rlt      = in.get_rlt_info();
@@ -56,8 +94,8 @@ void TxnAnalyzer::build_inputs(
 
         if (is_coinbase)
         {
-            ai.script_sig_hex = bytes_to_hex(in.scriptSig);
-            ai.script_asm     = disassemble_script(in.scriptSig);
+            ai.script_sig_hex = bytes_to_hex(in.scriptSig, mr_);
+            ai.script_asm     = disassemble_script(in.scriptSig, mr_);
             ai.script_type    = "coinbase";
             ai.prevout_value_sats        = 0;
             ai.prevout_script_pubkey_hex = "";
@@ -66,59 +104,70 @@ void TxnAnalyzer::build_inputs(
         }
 
         // Normal input — lookup prevout
-        std::string key = ai.txid + ":" + std::to_string(ai.vout);
+        std::pmr::string key(ai.txid, mr_);
+        key += ':';
+        key += std::to_string(ai.vout);
         auto it = prevout_map.find(key);
         if (it == prevout_map.end())
-            throw std::runtime_error("Missing prevout for input: " + key);
+            throw std::runtime_error("Missing prevout for input: " + std::string(key));
 
         const Prevout *prev = it->second;
 
-        ai.script_sig_hex = bytes_to_hex(in.scriptSig);
-        ai.script_asm     = disassemble_script(in.scriptSig);
+        ai.script_sig_hex = bytes_to_hex(in.scriptSig, mr_);
+        ai.script_asm     = disassemble_script(in.scriptSig, mr_);
 
+        ai.witness.reserve(in.witness.size());
         for (const auto &item : in.witness)
-            ai.witness.push_back(bytes_to_hex(item));
-
-        InputScriptType ist = classify_input(
-            prev->script_pubkey_hex, in.scriptSig, in.witness);
-        ai.script_type = input_script_type_str(ist);
+            ai.witness.push_back(bytes_to_hex(item, mr_));
 
         ProcessedScriptPubKey pspk =
-            process_output_script(prev->script_pubkey_hex);
+            process_compressed_script(prev->script_pubkey);
         if (pspk.address)
-            ai.address = pspk.address;
+            ai.address.emplace(*pspk.address, mr_);
 
+        InputScriptType ist = classify_input(pspk.type, in.scriptSig, in.witness);
+        ai.script_type = input_script_type_str(ist);
+
+        // The only place the full prevout script is needed
+        prev->script_pubkey.decompress(prevout_script);
         ai.prevout_value_sats        = prev->value_sats;
-        ai.prevout_script_pubkey_hex = bytes_to_hex(prev->script_pubkey_hex);
+        ai.prevout_script_pubkey_hex = bytes_to_hex(prevout_script, mr_);
 
         inputs_.push_back(std::move(ai));
     }
 }
 
-void TxnAnalyzer::build_outputs()
+template <typename Tx>
+void TxnAnalyzer::build_outputs(const Tx &tx, std::span<const uint8_t> output_types)
 {
-    for (size_t i = 0; i < tx_.outputs.size(); ++i)
+    outputs_.reserve(tx.outputs.size());
+
+    for (size_t i = 0; i < tx.outputs.size(); ++i)
     {
-        const TxOut &out = tx_.outputs[i];
+        const auto &out = tx.outputs[i];
 
-        AccountedOutput ao;
+        AccountedOutput ao(mr_);
         ao.n = static_cast<uint32_t>(i);
         ao.value_sats = out.amount;
-        ao.script_pubkey_hex = bytes_to_hex(out.scriptPubKey);
-        ao.script_asm = disassemble_script(out.scriptPubKey);
+        ao.script_pubkey_hex = bytes_to_hex(out.scriptPubKey, mr_);
+        ao.script_asm = disassemble_script(out.scriptPubKey, mr_);
 
-        ProcessedScriptPubKey pspk = process_output_script(out.scriptPubKey);
+        OutputScriptType type = output_types.empty()
+                                    ? classify_output_script(out.scriptPubKey)
+                                    : static_cast<OutputScriptType>(output_types[i]);
+        ProcessedScriptPubKey pspk = process_output_script(out.scriptPubKey, type);
         ao.script_type = output_script_type_str(pspk.type);
 
         if (pspk.address)
-            ao.address = pspk.address;
+            ao.address.emplace(*pspk.address, mr_);
 
         if (pspk.type == OutputScriptType::OP_RETURN && pspk.op_return)
         {
             const OPReturnPayload &payload = *pspk.op_return;
-            ao.op_return_data_hex = bytes_to_hex(payload.data);
-            ao.op_return_data_utf8 = payload.utf8;
-            ao.op_return_protocol = op_return_protocol_str(payload.protocol);
+            ao.op_return_data_hex.emplace(bytes_to_hex(payload.data, mr_));
+            if (payload.utf8)
+                ao.op_return_data_utf8.emplace(*payload.utf8, mr_);
+            ao.op_return_protocol.emplace(op_return_protocol_str(payload.protocol), mr_);
         }
 
         outputs_.push_back(std::move(ao));
@@ -142,7 +191,7 @@ void TxnAnalyzer::build_fee_info()
                     ? total_input_sats_ - total_output_sats_
                     : 0;
 
-    size_t vb = tx_.get_vbytes();
+    size_t vb = vbytes_;
     fee_rate_sat_vb_ = (vb > 0)
         ? std::round((static_cast<double>(fee_sats_) / vb) * 100.0) / 100.0
         : 0.0;
@@ -150,12 +199,12 @@ void TxnAnalyzer::build_fee_info()
 
 void TxnAnalyzer::build_segwit_savings()
 {
-    size_t total = tx_.get_size_bytes();
-    size_t w_act = tx_.get_weight();
+    size_t total = size_bytes_;
+    size_t w_act = weight_;
 
     size_t non_witness_bytes, witness_bytes, weight_if_legacy;
 
-    if (tx_.is_segwit())
+    if (segwit_)
     {
         // BIP 141: weight = 4*base + witness, total = base + 2 + witness
         // Solving: base = (w_act + 2 - total) / 3
@@ -184,7 +233,7 @@ void TxnAnalyzer::build_segwit_savings()
 
 void TxnAnalyzer::build_warnings()
 {
-    if (tx_.RBF_enabled())
+    if (rbf_)
         warnings_.push_back({WarningCode::RBF_SIGNALING});
 
     if (fee_sats_ > 1'000'000 || fee_rate_sat_vb_ > 200.0)
@@ -209,7 +258,9 @@ void TxnAnalyzer::build_warnings()
 
 BlockAnalyzer::BlockAnalyzer(const Block &block,
                              const UndoBlock &undo,
-                             const std::string &network)
+                             const std::string &network,
+                             std::pmr::memory_resource *mr)
+    : transactions(mr)
 {
     analyze(block, undo, network);
 }
@@ -224,7 +275,7 @@ void BlockAnalyzer::analyze(const Block &block,
 {
     analyze_header(block);
 
-    const std::vector<Transaction> &txs = block.getTransactions();
+    std::span<const TransactionView> txs = block.getTransactions();
 
     if (txs.empty())
         throw std::runtime_error("Block has no transactions");
@@ -233,7 +284,7 @@ void BlockAnalyzer::analyze(const Block &block,
 
     analyze_coinbase(txs[0]);
     analyze_transactions(block, undo, network);
-    compute_block_stats();
+    compute_block_stats(block);
 }
 
 void BlockAnalyzer::analyze_header(const Block &block)
@@ -269,28 +320,15 @@ void BlockAnalyzer::analyze_header(const Block &block)
                    header_root.begin());
 }
 
-void BlockAnalyzer::analyze_coinbase(const Transaction &cb_tx)
+void BlockAnalyzer::analyze_coinbase(const TransactionView &cb_tx)
 {
     if (cb_tx.inputs.empty())
         throw std::runtime_error("Coinbase has no inputs");
 
-    const std::vector<uint8_t> &script = cb_tx.inputs[0].scriptSig;
+    std::span<const uint8_t> script = cb_tx.inputs[0].scriptSig;
     coinbase.coinbase_script_hex = bytes_to_hex(script);
 
-    // BIP34: first byte = push length, followed by LE height bytes
-    coinbase.bip34_height = 0;
-    if (!script.empty())
-    {
-        uint8_t push_len = script[0];
-        if (push_len >= 1 && push_len <= 4 &&
-            script.size() >= static_cast<size_t>(1 + push_len))
-        {
-            uint32_t h = 0;
-            for (uint8_t i = 0; i < push_len; ++i)
-                h |= static_cast<uint32_t>(script[1 + i]) << (8 * i);
-            coinbase.bip34_height = h;
-        }
-    }
+    coinbase.bip34_height = bip34_height(script);
 
     coinbase.total_output_sats = 0;
     for (const auto &out : cb_tx.outputs)
@@ -303,18 +341,20 @@ void BlockAnalyzer::analyze_transactions(const Block &block,
 {
     const auto &txs       = block.getTransactions();
     const auto &undo_txs  = undo.getTransactions();
-
-    std::cerr << "[debug] block txs=" << txs.size()
-              << " undo txs=" << undo_txs.size()
-              << "\n";
+    const BlockColumns &cols = block.getColumns();
 
     if (undo_txs.size() != txs.size() - 1)
         throw std::runtime_error("Undo mismatch: tx count does not match");
 
+    // Results share the memory resource of the transactions vector
+    std::pmr::memory_resource *mr = transactions.get_allocator().resource();
+
     transactions.reserve(txs.size());
 
     // Coinbase (no undo)
-    transactions.emplace_back(txs[0], std::vector<Prevout>{}, network);
+    transactions.emplace_back(txs[0], cols.output_types(0), std::span<const Prevout>{}, network, mr);
+
+    std::pmr::vector<Prevout> prevouts(mr);
 
     for (size_t i = 1; i < txs.size(); ++i)
     {
@@ -324,50 +364,46 @@ void BlockAnalyzer::analyze_transactions(const Block &block,
         if (inputs.size() != undo_inputs.size())
             throw std::runtime_error("Undo mismatch: input count mismatch");
 
-        std::vector<Prevout> prevouts;
+        prevouts.clear();
         prevouts.reserve(inputs.size());
 
         for (size_t j = 0; j < inputs.size(); ++j)
         {
-            Prevout p;
+            Prevout &p = prevouts.emplace_back(mr);
             p.txid = reverse_32(inputs[j].prevTxId);
             p.vout = inputs[j].vout;
 
-            p.value_sats        = undo_inputs[j].value;
-            p.script_pubkey_hex = undo_inputs[j].scriptPubKey;
-
-            prevouts.push_back(std::move(p));
+            p.value_sats = undo_inputs[j].value;
+            p.script_pubkey = undo_inputs[j].scriptPubKey; // with its pubkey y
         }
 
-        transactions.emplace_back(txs[i], prevouts, network);
+        transactions.emplace_back(txs[i], cols.output_types(i), prevouts, network, mr);
     }
 }
 
-void BlockAnalyzer::compute_block_stats()
+// Sums and script type counts come from the block's columns, only the
+// fees need the per tx analysis (they depend on the undo data)
+void BlockAnalyzer::compute_block_stats(const Block &block)
 {
+    const BlockColumns &cols = block.getColumns();
+
     block_stats.total_fees_sats = 0;
-    block_stats.total_weight = 0;
+    block_stats.total_weight = cols.total_weight();
     block_stats.script_type_summary.clear();
 
-    uint64_t total_vbytes = 0;
-
-    for (size_t i = 0; i < transactions.size(); ++i)
-    {
-        const TxnAnalyzer &ta = transactions[i];
+    uint64_t total_vbytes = cols.total_vbytes();
 
-        block_stats.total_weight += ta.weight();
-        total_vbytes += ta.vbytes();
+    for (size_t i = 1; i < transactions.size(); ++i)
+        block_stats.total_fees_sats += transactions[i].fee_sats();
 
-        if (i > 0)
-            block_stats.total_fees_sats += ta.fee_sats();
-
-        for (const auto &out : ta.vout())
-            block_stats.script_type_summary[out.script_type]++;
-    }
+    std::array<uint64_t, OUTPUT_SCRIPT_TYPE_COUNT> counts = cols.script_type_counts();
+    for (size_t t = 0; t < counts.size(); ++t)
+        if (counts[t] > 0)
+            block_stats.script_type_summary[output_script_type_str(static_cast<OutputScriptType>(t))] = counts[t];
 
     block_stats.avg_fee_rate_sat_vb =
         total_vbytes > 0
             ? static_cast<double>(block_stats.total_fees_sats) /
                   total_vbytes
             : 0.0;
-}
\ No newline at end of file
+}
@@ -2,16 +2,20 @@
 #define ACCOUNTING_H
 
 #include "transaction.h"
+#include "transaction_view.h"
 #include "block.h"
 #include "script.h"
 #include "script_processor.h"
 #include "utilities.h"
+#include "compressed_script.h"
 #include <string>
 #include <vector>
 #include <optional>
 #include <cmath>
 #include <unordered_map>
 #include <map>
+#include <span>
+#include <memory_resource>
 
 // INPUT part SINGLE TXN MODE
 
@@ -23,7 +27,11 @@ public:
     std::array<uint8_t, 32> txid;
     uint32_t vout;
     uint64_t value_sats;
-    std::vector<uint8_t> script_pubkey_hex;
+    // Compressed as in undo data, full scripts from JSON input are kept raw
+    CompressedScript script_pubkey;
+
+    explicit Prevout(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+        : script_pubkey(mr) {}
 };
 
 // Input (from JSON file)
@@ -88,21 +96,27 @@ struct TxWarning
 };
 
 // Processed input field in a txn
+// Strings live in the memory resource given to the constructor, optional
+// ones should be emplaced with it too
 struct AccountedInput
 {
-    std::string txid; // hex, reversed (display order)
+    std::pmr::string txid; // hex, reversed (display order)
     uint32_t vout;
     uint32_t sequence;
-    std::string script_sig_hex;
-    std::string script_asm;
-    std::vector<std::string> witness; // each item hex-encoded
-    std::string script_type;
-    std::optional<std::string> address;
+    std::pmr::string script_sig_hex;
+    std::pmr::string script_asm;
+    std::pmr::vector<std::pmr::string> witness; // each item hex-encoded
+    std::pmr::string script_type;
+    std::optional<std::pmr::string> address;
 
     uint64_t prevout_value_sats;
-    std::string prevout_script_pubkey_hex;
+    std::pmr::string prevout_script_pubkey_hex;
 
     RelativeLocktimeInfo rlt;
+
+    explicit AccountedInput(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+        : txid(mr), script_sig_hex(mr), script_asm(mr), witness(mr),
+          script_type(mr), prevout_script_pubkey_hex(mr) {}
 };
 
 // Processed output
@@ -110,57 +124,88 @@ struct AccountedOutput
 {
     uint32_t n;
     uint64_t value_sats;
-    std::string script_pubkey_hex;
-    std::string script_asm;
-    std::string script_type;
-    std::optional<std::string> address;
-
-    std::optional<std::string> op_return_data_hex;
-    std::optional<std::string> op_return_data_utf8;
-    std::optional<std::string> op_return_protocol;
+    std::pmr::string script_pubkey_hex;
+    std::pmr::string script_asm;
+    std::pmr::string script_type;
+    std::optional<std::pmr::string> address;
+
+    std::optional<std::pmr::string> op_return_data_hex;
+    std::optional<std::pmr::string> op_return_data_utf8;
+    std::optional<std::pmr::string> op_return_protocol;
+
+    explicit AccountedOutput(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+        : script_pubkey_hex(mr), script_asm(mr), script_type(mr) {}
 };
 
 // Main accounting class for Txn
 // Contains all the info we want for our final output
+// Everything is computed in the constructor, the analyzer does not keep a
+// reference to the transaction. Its results are allocated from mr.
 class TxnAnalyzer
 {
 public:
     TxnAnalyzer(
         const Transaction &tx,
-        const std::vector<Prevout> &prevouts,
-        const std::string &network);
+        std::span<const Prevout> prevouts,
+        const std::string &network,
+        std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // Same for a transaction parsed in place (block mode). output_types are
+    // its outputs' OutputScriptType, already classified by the block's
+    // columns, so the scripts are not classified again.
+    TxnAnalyzer(
+        const TransactionView &tx,
+        std::span<const uint8_t> output_types,
+        std::span<const Prevout> prevouts,
+        const std::string &network,
+        std::pmr::memory_resource *mr = std::pmr::get_default_resource());
 
     bool ok() const
     {
         return true;
     }
     std::string network() const { return network_; }
-    bool segwit() const { return tx_.is_segwit(); }
-    std::string txid() const { return bytes_to_hex(tx_.get_txid()); }
-    std::string wtxid() const { return bytes_to_hex(tx_.get_wtxid()); }
-    uint32_t version() const { return tx_.version; }
-    uint32_t locktime() const { return tx_.locktime; }
-    size_t size_bytes() const { return tx_.get_size_bytes(); }
-    size_t weight() const { return tx_.get_weight(); }
-    size_t vbytes() const { return tx_.get_vbytes(); }
+    bool segwit() const { return segwit_; }
+    std::string txid() const { return bytes_to_hex(txid_); }
+    std::string wtxid() const { return bytes_to_hex(wtxid_); }
+    uint32_t version() const { return version_; }
+    uint32_t locktime() const { return locktime_; }
+    size_t size_bytes() const { return size_bytes_; }
+    size_t weight() const { return weight_; }
+    size_t vbytes() const { return vbytes_; }
 
     uint64_t total_input_sats() const { return total_input_sats_; }
     uint64_t total_output_sats() const { return total_output_sats_; }
     uint64_t fee_sats() const { return fee_sats_; }
     double fee_rate_sat_vb() const { return fee_rate_sat_vb_; }
 
-    bool rbf_signaling() const { return tx_.RBF_enabled(); }
-    std::string locktime_type() const { return locktime_type_str(tx_.get_locktime_type()); }
-    uint32_t locktime_value() const { return tx_.locktime; }
+    bool rbf_signaling() const { return rbf_; }
+    std::string locktime_type() const { return locktime_type_str(locktime_type_); }
+    uint32_t locktime_value() const { return locktime_; }
 
     const SegwitSavings &segwit_savings() const { return segwit_savings_; }
-    const std::vector<AccountedInput> &vin() const { return inputs_; }
-    const std::vector<AccountedOutput> &vout() const { return outputs_; }
-    const std::vector<TxWarning> &warnings() const { return warnings_; }
+    const std::pmr::vector<AccountedInput> &vin() const { return inputs_; }
+    const std::pmr::vector<AccountedOutput> &vout() const { return outputs_; }
+    const std::pmr::vector<TxWarning> &warnings() const { return warnings_; }
 
 private:
-    const Transaction &tx_;
+    // "txid_hex:vout" -> prevout
+    using PrevoutMap = std::pmr::unordered_map<std::pmr::string, const Prevout *>;
+
     std::string network_;
+    std::pmr::memory_resource *mr_;
+
+    // copied from the transaction
+    bool segwit_ = false;
+    std::array<uint8_t, 32> txid_{};
+    std::array<uint8_t, 32> wtxid_{};
+    uint32_t version_ = 0;
+    uint32_t locktime_ = 0;
+    size_t size_bytes_ = 0;
+    size_t weight_ = 0;
+    size_t vbytes_ = 0;
+    bool rbf_ = false;
+    LockTimeType locktime_type_ = LockTimeType::NONE;
 
     uint64_t total_input_sats_ = 0;
     uint64_t total_output_sats_ = 0;
@@ -168,13 +213,22 @@ private:
     double fee_rate_sat_vb_ = 0.0;
 
     SegwitSavings segwit_savings_{};
-    std::vector<AccountedInput> inputs_;
-    std::vector<AccountedOutput> outputs_;
-    std::vector<TxWarning> warnings_;
+    std::pmr::vector<AccountedInput> inputs_;
+    std::pmr::vector<AccountedOutput> outputs_;
+    std::pmr::vector<TxWarning> warnings_;
+
+    // Tx is Transaction or TransactionView
+    // Empty output_types: classify the output scripts here
+    template <typename Tx>
+    void analyze(const Tx &tx, std::span<const Prevout> prevouts,
+                 std::span<const uint8_t> output_types);
+
+    template <typename Tx>
+    void build_inputs(const Tx &tx, const PrevoutMap &prevout_map);
+
+    template <typename Tx>
+    void build_outputs(const Tx &tx, std::span<const uint8_t> output_types);
 
-    void build_inputs(
-        const std::unordered_map<std::string, const Prevout *> &prevout_map);
-    void build_outputs();
     void build_fee_info();
     void build_segwit_savings();
     void build_warnings();
@@ -225,16 +279,19 @@ public:
 
     CoinBaseInfo coinbase;
 
-    std::vector<TxnAnalyzer> transactions;
+    std::pmr::vector<TxnAnalyzer> transactions;
 
     BlockStats block_stats;
 
 public:
     BlockAnalyzer() = default;
 
+    // Per tx results are allocated from mr (e.g. the BlockArena that
+    // block and undo were parsed into)
     BlockAnalyzer(const Block &block,
                   const UndoBlock &undo,
-                  const std::string &network);
+                  const std::string &network,
+                  std::pmr::memory_resource *mr = std::pmr::get_default_resource());
 
 private:
     void analyze(const Block &block,
@@ -242,11 +299,11 @@ private:
                  const std::string &network);
 
     void analyze_header(const Block &block);
-    void analyze_coinbase(const Transaction &coinbase_tx);
+    void analyze_coinbase(const TransactionView &coinbase_tx);
     void analyze_transactions(const Block &block,
                               const UndoBlock &undo,
                               const std::string &network);
-    void compute_block_stats();
+    void compute_block_stats(const Block &block);
 };
 
 #endif // ACCOUNTING_H
@@ -0,0 +1,334 @@
+#include "async_reader.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TX_TOOL_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+// ---------------- io_uring ring ----------------
+// Talks to the kernel directly (io_uring_setup / io_uring_enter + the shared
+// rings), which is all we need for plain reads and saves a liburing dependency.
+
+#ifdef TX_TOOL_IO_URING
+
+struct AsyncFileReader::Ring
+{
+    int fd = -1;
+
+    void *sq_ptr = MAP_FAILED;
+    size_t sq_len = 0;
+    void *cq_ptr = MAP_FAILED;
+    size_t cq_len = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqes_len = 0;
+
+    unsigned *sq_head = nullptr, *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    // Returns nullptr if the kernel does not let us have a ring
+    static std::unique_ptr<Ring> create(unsigned entries)
+    {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+
+        int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0)
+            return nullptr;
+
+        auto r = std::make_unique<Ring>();
+        r->fd = fd;
+
+        r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+        // Newer kernels share one mapping for both rings
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            r->sq_len = r->cq_len = std::max(r->sq_len, r->cq_len);
+
+        r->sq_ptr = ::mmap(nullptr, r->sq_len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (r->sq_ptr == MAP_FAILED)
+            return nullptr;
+
+        if (single)
+        {
+            r->cq_ptr = r->sq_ptr;
+        }
+        else
+        {
+            r->cq_ptr = ::mmap(nullptr, r->cq_len, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (r->cq_ptr == MAP_FAILED)
+                return nullptr;
+        }
+
+        r->sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+        r->sqes = static_cast<io_uring_sqe *>(
+            ::mmap(nullptr, r->sqes_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (r->sqes == MAP_FAILED)
+            return nullptr;
+
+        auto *sq = static_cast<uint8_t *>(r->sq_ptr);
+        r->sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        r->sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        r->sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        r->sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+
+        auto *cq = static_cast<uint8_t *>(r->cq_ptr);
+        r->cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        r->cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        r->cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        r->cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+
+        return r;
+    }
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED)
+            ::munmap(sqes, sqes_len);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+            ::munmap(cq_ptr, cq_len);
+        if (sq_ptr != MAP_FAILED)
+            ::munmap(sq_ptr, sq_len);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    // Queues one read, the caller makes sure the ring is not full
+    void push_read(int file_fd, uint8_t *dst, size_t len, size_t offset)
+    {
+        unsigned tail = *sq_tail;
+        unsigned idx = tail & *sq_mask;
+
+        io_uring_sqe &sqe = sqes[idx];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = file_fd;
+        sqe.addr = reinterpret_cast<uint64_t>(dst);
+        sqe.len = static_cast<uint32_t>(len);
+        sqe.off = offset;
+        sqe.user_data = offset;
+
+        sq_array[idx] = idx;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // Submits everything queued, optionally waiting for min_complete completions
+    int enter(unsigned to_submit, unsigned min_complete)
+    {
+        unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        int ret;
+        do
+        {
+            ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                             min_complete, flags, nullptr, 0));
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+    }
+};
+
+#else
+
+struct AsyncFileReader::Ring
+{
+};
+
+#endif
+
+// ---------------- AsyncFileReader ----------------
+
+AsyncFileReader::AsyncFileReader(const std::string &path,
+                                 unsigned queue_depth,
+                                 size_t chunk_size)
+    : path_(path),
+      queue_depth_(std::max(1u, queue_depth)),
+      chunk_size_(std::max<size_t>(chunk_size, 4096))
+{
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+        throw std::runtime_error("AsyncFileReader: cannot open: " + path);
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        ::close(fd_);
+        throw std::runtime_error("AsyncFileReader: cannot stat: " + path);
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    buffer_.resize(size_);
+
+#ifdef TX_TOOL_IO_URING
+    if (size_ > 0)
+        ring_ = Ring::create(queue_depth_);
+#endif
+
+    if (ring_)
+        submit_more();
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    // The kernel may still be writing into buffer_, wait before freeing it.
+    // If the ring cannot tell us when it is done, leak the buffer rather
+    // than free memory under a pending read.
+    if (ring_ && !drain())
+        (void)new FileBuffer(std::move(buffer_));
+
+    ring_.reset();
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+// Tops the ring up to queue_depth_ reads in flight
+void AsyncFileReader::submit_more()
+{
+#ifdef TX_TOOL_IO_URING
+    size_t batch_start = next_offset_;
+    unsigned queued = 0;
+    while (!submit_failed_ && in_flight_ < queue_depth_ && next_offset_ < size_)
+    {
+        size_t len = std::min(chunk_size_, size_ - next_offset_);
+        ring_->push_read(fd_, buffer_.data() + next_offset_, len, next_offset_);
+        next_offset_ += len;
+        in_flight_++;
+        queued++;
+    }
+
+    // io_uring_enter may consume fewer SQEs than asked, the rest stay in
+    // the ring for the next call
+    unsigned submitted = 0;
+    while (submitted < queued)
+    {
+        int n = ring_->enter(queued - submitted, 0);
+        if (n <= 0)
+            break;
+        submitted += static_cast<unsigned>(n);
+    }
+
+    if (submitted < queued)
+    {
+        // Could not submit the rest, finish() reads it the blocking way.
+        // Every chunk but the batch's last is full size, so the unsubmitted
+        // (trailing) reads start here. Nothing is submitted after this, so
+        // their SQEs are never consumed.
+        in_flight_ -= queued - submitted;
+        next_offset_ = batch_start + submitted * chunk_size_;
+        submit_failed_ = true;
+    }
+#endif
+}
+
+// Handles completed reads, blocking for at least one if wait is set.
+// False if waiting failed, the reads still in flight stay counted.
+bool AsyncFileReader::reap(bool wait)
+{
+#ifdef TX_TOOL_IO_URING
+    if (wait && ring_->enter(0, 1) < 0)
+    {
+        if (!error_)
+            error_ = std::string("io_uring_enter failed: ") + std::strerror(errno);
+        return false;
+    }
+
+    unsigned head = *ring_->cq_head;
+    unsigned tail = __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe &cqe = ring_->cqes[head & *ring_->cq_mask];
+        size_t offset = static_cast<size_t>(cqe.user_data);
+        size_t len = std::min(chunk_size_, size_ - offset);
+        in_flight_--;
+
+        // Errors (e.g. IORING_OP_READ unsupported before 5.6) and short reads
+        // are finished with pread, they are rare enough not to matter
+        size_t got = cqe.res > 0 ? static_cast<size_t>(cqe.res) : 0;
+        done_bytes_ += got;
+        if (got < len)
+            read_sync(offset + got, len - got);
+    }
+
+    __atomic_store_n(ring_->cq_head, head, __ATOMIC_RELEASE);
+#endif
+    return true;
+}
+
+// Waits for every read in flight, false if the ring stopped answering
+bool AsyncFileReader::drain()
+{
+    while (in_flight_ > 0)
+    {
+        if (!reap(true))
+            return false;
+    }
+    return true;
+}
+
+void AsyncFileReader::read_sync(size_t offset, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::pread(fd_, buffer_.data() + offset, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            error_ = "read error: " + path_;
+            return;
+        }
+        offset += static_cast<size_t>(n);
+        len -= static_cast<size_t>(n);
+        done_bytes_ += static_cast<size_t>(n);
+    }
+}
+
+FileBuffer AsyncFileReader::finish()
+{
+    if (finished_)
+        throw std::runtime_error("AsyncFileReader: finish() called twice");
+    finished_ = true;
+
+    while (ring_ && !error_)
+    {
+        submit_more();
+        if (in_flight_ == 0)
+            break;
+        reap(true);
+    }
+
+    // A read error stops submitting, but what is in flight still lands in
+    // buffer_. Nothing may be outstanding once it is moved out or freed, the
+    // destructor deals with a ring that cannot be drained.
+    if (ring_ && !drain())
+        throw std::runtime_error("AsyncFileReader: " + *error_);
+
+    // Fallback path, or whatever the ring did not get to
+    while (next_offset_ < size_ && !error_)
+    {
+        size_t len = std::min(chunk_size_, size_ - next_offset_);
+        read_sync(next_offset_, len);
+        next_offset_ += len;
+    }
+
+    if (error_)
+        throw std::runtime_error("AsyncFileReader: " + *error_);
+    if (done_bytes_ != size_)
+        throw std::runtime_error("AsyncFileReader: short read: " + path_);
+
+    return std::move(buffer_);
+}
@@ -0,0 +1,68 @@
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+
+#include "mapped_file.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+// Reads a whole file into memory with several large reads in flight.
+// Reads are submitted through io_uring as soon as the reader is constructed,
+// so the caller can keep parsing something else while the kernel fills the
+// buffer, and only blocks in finish(). Where io_uring is not available
+// (old kernel, seccomp, non Linux) it falls back to plain blocking pread()s.
+class AsyncFileReader
+{
+public:
+    static constexpr unsigned DEFAULT_QUEUE_DEPTH = 8;
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 16 * 1024 * 1024;
+
+    // queue_depth : reads kept in flight at once
+    // chunk_size  : bytes per read
+    AsyncFileReader(const std::string &path,
+                    unsigned queue_depth = DEFAULT_QUEUE_DEPTH,
+                    size_t chunk_size = DEFAULT_CHUNK_SIZE);
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader &) = delete;
+    AsyncFileReader &operator=(const AsyncFileReader &) = delete;
+
+    // Waits for the outstanding reads and hands over the file contents.
+    // Can only be called once, throws on read errors.
+    FileBuffer finish();
+
+    const std::string &path() const { return path_; }
+    size_t size() const { return size_; }
+
+    // True if this reader got an io_uring, false if it uses the fallback
+    bool uses_io_uring() const { return ring_ != nullptr; }
+
+private:
+    struct Ring;
+
+    void submit_more();
+    bool reap(bool wait);
+    bool drain();
+    void read_sync(size_t offset, size_t len);
+
+    std::string path_;
+    int fd_ = -1;
+    size_t size_ = 0;
+    unsigned queue_depth_;
+    size_t chunk_size_;
+
+    FileBuffer buffer_;
+    size_t next_offset_ = 0; // first byte not yet submitted
+    size_t done_bytes_ = 0;  // bytes landed in buffer_
+    unsigned in_flight_ = 0;
+    bool finished_ = false;
+    bool submit_failed_ = false;
+    std::optional<std::string> error_;
+
+    std::unique_ptr<Ring> ring_;
+};
+
+#endif
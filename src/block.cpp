@@ -1,4 +1,14 @@
 #include "block.h"
+#include "byte_reader.h"
+#include "parallel_for.h"
+
+// Below this many transactions (undo txs) per thread a block is parsed on
+// the calling thread, starting threads would cost more than it saves
+static constexpr size_t MIN_TXS_PER_THREAD = 64;
+
+// Same for pubkey decompressions, a modular square root each
+static constexpr size_t MIN_PUBKEYS_PER_THREAD = 64;
+
 
 // BlockHeader
 
@@ -12,47 +22,23 @@ BlockHeader::BlockHeader()
 
 BlockHeader::BlockHeader(std::array<uint8_t, 80> &blk_header_hex_bytes)
 {
-    // Convert to vector once for the read helpers
-    std::vector<uint8_t> blk_header_in_v(blk_header_hex_bytes.begin(), blk_header_hex_bytes.end());
-    size_t off = 0;
-
-    version = read_uint32_le(blk_header_in_v, off);
-    off += 4;
-
-    std::copy(blk_header_hex_bytes.begin() + off, blk_header_hex_bytes.begin() + off + 32, prevBlock.begin());
-    off += 32;
+    // Fixed 80 byte layout, the array size is the bounds check
+    ByteReader<UncheckedBounds> r(blk_header_hex_bytes);
 
-    std::copy(blk_header_hex_bytes.begin() + off, blk_header_hex_bytes.begin() + off + 32, merkleRoot.begin());
-    off += 32;
+    version = r.u32();
+    prevBlock = r.array<32>();
+    merkleRoot = r.array<32>();
+    timestamp = r.u32();
+    bits = r.u32();
+    nonce = r.u32();
 
-    timestamp = read_uint32_le(blk_header_in_v, off);
-    off += 4;
-    bits = read_uint32_le(blk_header_in_v, off);
-    off += 4;
-    nonce = read_uint32_le(blk_header_in_v, off);
-
-    calcBlockHash();
+    calcBlockHash(blk_header_hex_bytes);
 }
 
-void BlockHeader::calcBlockHash()
+// The fields are the raw bytes as read, so they are hashed as is
+void BlockHeader::calcBlockHash(std::span<const uint8_t, 80> raw)
 {
-    std::vector<uint8_t> buf;
-    buf.reserve(80);
-
-    auto w32 = [&](uint32_t val)
-    {
-        for (int i = 0; i < 4; ++i)
-            buf.push_back(static_cast<uint8_t>(val >> (8 * i)));
-    };
-
-    w32(version);
-    buf.insert(buf.end(), prevBlock.begin(), prevBlock.end());
-    buf.insert(buf.end(), merkleRoot.begin(), merkleRoot.end());
-    w32(timestamp);
-    w32(bits);
-    w32(nonce);
-
-    blockHash = reverse_32(double_sha256(buf));
+    blockHash = reverse_32(Sha256Hasher().write(raw).finalize_double());
 }
 
 int32_t BlockHeader::getVersion() const { return static_cast<int32_t>(version); }
@@ -67,65 +53,110 @@ std::string BlockHeader::getHashStr() const { return bytes_to_hex(blockHash); }
 
 // Block
 
-Block::Block(std::vector<uint8_t> &blk_hex_bytes)
+Block::Block(std::span<const uint8_t> blk_hex_bytes, std::pmr::memory_resource *mr,
+             unsigned threads)
+    : Block(mr)
+{
+    reparse(blk_hex_bytes, threads);
+}
+
+Block::Block(std::pmr::memory_resource *mr)
+    : magic(0), blockSize(0), txnCounter(0), txRanges(mr), txs(mr), columns(mr)
+{
+}
+
+void Block::reparse(std::span<const uint8_t> blk_hex_bytes, unsigned threads,
+                    std::span<const std::array<uint8_t, 32>> txids)
 {
+    std::pmr::memory_resource *mr = txs.get_allocator().resource();
+
+    liveTxs = 0;
+    txRanges.clear();
+    columns.clear();
+
     if (blk_hex_bytes.size() < 8)
         throw std::runtime_error("Block: buffer too short");
 
-    size_t off = 0;
-
-    magic = read_uint32_le(blk_hex_bytes, off);
-    off += 4;
-    blockSize = read_uint32_le(blk_hex_bytes, off);
-    off += 4;
+    ByteReader<CheckedBounds> r(blk_hex_bytes, 0, "Block");
 
-    if (blk_hex_bytes.size() < off + 80)
-        throw std::runtime_error("Block: not enough bytes for block header");
+    magic = r.u32("magic");
+    blockSize = r.u32("size");
 
-    std::array<uint8_t, 80> hdr_bytes;
-    std::copy(blk_hex_bytes.begin() + off, blk_hex_bytes.begin() + off + 80, hdr_bytes.begin());
+    std::array<uint8_t, 80> hdr_bytes = r.array<80>("block header");
     blockHeader = BlockHeader(hdr_bytes);
-    off += 80;
 
-    txnCounter = read_varint(blk_hex_bytes, off);
-    txs.reserve(txnCounter);
+    txnCounter = r.varint("tx count");
 
+    // Pass 1: transaction boundaries only, every length checked
+    txRanges.reserve(std::min<uint64_t>(txnCounter, r.remaining() / MIN_TX_SIZE));
+
+    size_t off = r.offset();
     for (uint64_t i = 0; i < txnCounter; ++i)
     {
-        Transaction tx(blk_hex_bytes, off);
-        txs.push_back(std::move(tx));
+        txRanges.push_back(scan_transaction(blk_hex_bytes, off));
+        off = txRanges.back().end;
     }
+
+    if (!txids.empty() && txids.size() != txRanges.size())
+        throw std::runtime_error("Block: txid count does not match tx count");
+
+    // Pass 2: tables and txid/wtxid hashing, each slice of transactions on
+    // its own thread. The slices allocate concurrently, so they need a
+    // thread safe resource on top of mr. The pooled transactions were built
+    // on mr until the first parallel block, those are dropped once.
+    if (!sharedMr && parallel_for_threads(txRanges.size(), threads, MIN_TXS_PER_THREAD) > 1)
+    {
+        txs.clear();
+        sharedMr = std::make_unique<std::pmr::synchronized_pool_resource>(mr);
+    }
+    std::pmr::memory_resource *tx_mr = sharedMr ? sharedMr.get() : mr;
+
+    txs.reserve(txRanges.size());
+    while (txs.size() < txRanges.size())
+        txs.emplace_back(tx_mr);
+
+    parallel_for(txRanges.size(), threads, MIN_TXS_PER_THREAD, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            txs[i].parse(blk_hex_bytes, txRanges[i], txids.empty() ? nullptr : &txids[i]);
+    });
+
+    for (size_t i = 0; i < txRanges.size(); ++i)
+        columns.add(txs[i], blk_hex_bytes);
+
+    liveTxs = txRanges.size();
 }
 
 uint32_t Block::getMagicNumber() const { return magic; }
 uint32_t Block::getSize() const { return blockSize; }
 BlockHeader Block::getHeader() const { return blockHeader; }
 uint32_t Block::getTransactionCount() const { return static_cast<uint32_t>(txnCounter); }
-const std::vector<Transaction> &Block::getTransactions() const
+std::span<const TransactionView> Block::getTransactions() const
 {
-    return txs;
+    return {txs.data(), liveTxs};
 }
 
 uint64_t Block::getOutputsValue() const
 {
-    uint64_t total = 0;
-    for (const auto &tx : txs)
-        for (const auto &out : tx.outputs)
-            total += out.amount;
-    return total;
+    return columns.total_output_value();
 }
 
 std::vector<uint8_t> Block::calcMerkleRoot() const
 {
-    if (txs.empty())
-        return std::vector<uint8_t>(32, 0);
-
     // Leaf layer: raw (un-reversed) txid hashes
     std::vector<std::array<uint8_t, 32>> layer;
-    layer.reserve(txs.size());
-    for (auto &tx : txs)
+    layer.reserve(liveTxs);
+    for (const TransactionView &tx : getTransactions())
         layer.push_back(reverse_32(tx.get_txid())); // un-reverse display txid
 
+    return merkle_root(std::move(layer));
+}
+
+std::vector<uint8_t> merkle_root(std::vector<std::array<uint8_t, 32>> layer)
+{
+    if (layer.empty())
+        return std::vector<uint8_t>(32, 0);
+
     while (layer.size() > 1)
     {
         if (layer.size() % 2 != 0)
@@ -147,6 +178,22 @@ std::vector<uint8_t> Block::calcMerkleRoot() const
     return std::vector<uint8_t>(layer[0].begin(), layer[0].end());
 }
 
+// BIP34: first byte = push length, followed by LE height bytes
+uint32_t bip34_height(std::span<const uint8_t> script)
+{
+    if (script.empty())
+        return 0;
+
+    uint8_t push_len = script[0];
+    if (push_len < 1 || push_len > 4 || script.size() < static_cast<size_t>(1 + push_len))
+        return 0;
+
+    uint32_t h = 0;
+    for (uint8_t i = 0; i < push_len; ++i)
+        h |= static_cast<uint32_t>(script[1 + i]) << (8 * i);
+    return h;
+}
+
 // UndoTx
 
 static uint64_t decompress_amount(uint64_t x)
@@ -172,186 +219,249 @@ static uint64_t decompress_amount(uint64_t x)
     return n;
 }
 
-static std::vector<uint8_t> decompress_script(
-    uint64_t type, const std::vector<uint8_t> &data, size_t &off)
+// The Coin fields in undo data use Bitcoin Core's VARINT (serialize.h),
+// ByteReader::cvarint -- DIFFERENT from the CompactSize input count.
+UndoTx::UndoTx(std::span<const uint8_t> data, size_t &off, std::pmr::memory_resource *mr)
+    : spentOutputs(mr)
 {
-    auto read_n = [&](size_t n) -> std::vector<uint8_t>
-    {
-        if (off + n > data.size())
-            throw std::runtime_error("decompress_script: underflow");
-        std::vector<uint8_t> out(data.begin() + off, data.begin() + off + n);
-        off += n;
-        return out;
-    };
+    parse(data, off);
+}
 
-    std::vector<uint8_t> script;
-    switch (type)
-    {
-    case 0:
-    { // P2PKH
-        auto h = read_n(20);
-        script = {0x76, 0xa9, 0x14};
-        script.insert(script.end(), h.begin(), h.end());
-        script.push_back(0x88);
-        script.push_back(0xac);
-        break;
-    }
-    case 1:
-    { // P2SH
-        auto h = read_n(20);
-        script = {0xa9, 0x14};
-        script.insert(script.end(), h.begin(), h.end());
-        script.push_back(0x87);
-        break;
-    }
-    case 2:
-    case 3:
-    { // P2PK compressed
-        auto x = read_n(32);
-        script = {0x21, static_cast<uint8_t>(type)};
-        script.insert(script.end(), x.begin(), x.end());
-        script.push_back(0xac);
-        break;
-    }
-    case 4:
-    case 5:
-    {
-        // Read 32-byte X coordinate
-        auto x = read_n(32);
-
-        // Reconstruct compressed pubkey (33 bytes)
-        unsigned char compressed[33];
-        compressed[0] = static_cast<unsigned char>(type - 2); // 0x02 or 0x03
-        std::memcpy(compressed + 1, x.data(), 32);
-
-        // Parse using secp256k1
-        secp256k1_pubkey pubkey;
-
-        if (!secp256k1_ec_pubkey_parse(
-                Secp256k1Context::instance(),
-                &pubkey,
-                compressed,
-                33))
-        {
-            throw std::runtime_error("Invalid compressed pubkey in undo data");
-        }
+UndoTx::UndoTx(std::pmr::memory_resource *mr)
+    : inputCount(0), spentOutputs(mr)
+{
+}
 
-        // Serialize as uncompressed (65 bytes)
-        unsigned char full[65];
-        size_t full_len = 65;
+void UndoTx::parse(std::span<const uint8_t> data, size_t &off)
+{
+    std::pmr::memory_resource *mr = spentOutputs.get_allocator().resource();
+    inputCount = 0;
 
-        secp256k1_ec_pubkey_serialize(
-            Secp256k1Context::instance(),
-            full,
-            &full_len,
-            &pubkey,
-            SECP256K1_EC_UNCOMPRESSED);
+    ByteReader<CheckedBounds> r(data, off, "UndoTx");
 
-        if (full_len != 65)
-            throw std::runtime_error("Unexpected pubkey length");
+    uint64_t input_count = r.varint("input count");
 
-        // Build script:
-        // OP_PUSH65 <65-byte pubkey> OP_CHECKSIG
-        script.clear();
-        script.push_back(0x41); // push 65 bytes
-        script.insert(script.end(), full, full + 65);
-        script.push_back(0xac); // OP_CHECKSIG
+    // A coin takes at least 3 bytes, keeps a corrupt count from reserving GBs
+    spentOutputs.reserve(std::min<uint64_t>(input_count, r.remaining() / 3));
 
-        break;
-    }
-    default:
+    for (uint64_t i = 0; i < input_count; i++)
     {
-        if (type < 6)
-            throw std::runtime_error("Invalid script type");
+        if (i == spentOutputs.size())
+            spentOutputs.push_back(UndoCoin{0, false, 0, CompressedScript(mr)});
+        UndoCoin &coin = spentOutputs[i];
 
-        script = read_n(static_cast<size_t>(type - 6));
-        break;
-    }
+        uint64_t code = r.cvarint("coin code");
+        coin.height = code >> 1;
+        coin.isCoinbase = code & 1;
+
+        // Legacy version byte, written for height > 0, always 0
+        if (coin.height > 0)
+            r.skip(1, "version dummy");
+
+        // CompressedAmount (CVarInt)
+        uint64_t compressed = r.cvarint("amount");
+        coin.value = decompress_amount(compressed);
+
+        // CompressedScript (type CVarInt + data bytes), kept compressed
+        uint64_t script_type = r.cvarint("script type");
+        coin.scriptPubKey.assign(script_type,
+                                 r.bytes(compressed_script_size(script_type), "compressed script"));
     }
-    return script;
+
+    inputCount = input_count;
+    off = r.offset();
 }
 
-// Bitcoin Core CVarInt decoder (serialize.h).
-// Used for all Coin fields in undo data -- DIFFERENT from CompactSize (read_varint).
-// Each byte stores 7 bits of value; high bit = more bytes follow.
-// On continuation, add 1 to de-bias (ensures unique encoding per value).
-static uint64_t read_cvarint(const std::vector<uint8_t> &data, size_t &off)
+// UndoBlock
+
+// Walks one undo tx without decoding anything, returns the offset past it
+static size_t skip_undo_tx(std::span<const uint8_t> data, size_t off)
 {
-    uint64_t n = 0;
-    while (true)
+    ByteReader<CheckedBounds> r(data, off, "UndoTx");
+
+    uint64_t input_count = r.varint("input count");
+    for (uint64_t i = 0; i < input_count; i++)
     {
-        if (off >= data.size())
-            throw std::runtime_error("read_cvarint: underflow");
-        uint8_t b = data[off++];
-        n = (n << 7) | (b & 0x7F);
-        if (b & 0x80)
-            n += 1;
-        else
-            break;
+        if (static_cast<uint32_t>(r.cvarint("coin code") >> 1) > 0) // UndoCoin::height
+            r.skip(1, "version dummy");
+        r.cvarint("amount");
+        r.skip(compressed_script_size(r.cvarint("script type")), "compressed script");
     }
-    return n;
+
+    return r.offset();
 }
 
-UndoTx::UndoTx(std::vector<uint8_t> &data, size_t &off)
+UndoBlock::UndoBlock(std::span<const uint8_t> raw, std::pmr::memory_resource *mr,
+                     unsigned threads)
+    : UndoBlock(mr)
 {
-    uint64_t input_count = read_varint(data, off);
-    spentOutputs.reserve(input_count);
+    reparse(raw, threads);
+}
 
-    for (uint64_t i = 0; i < input_count; i++)
+UndoBlock::UndoBlock(std::span<const uint8_t> raw,
+                     const std::array<uint8_t, 32> &prev_block_hash,
+                     std::pmr::memory_resource *mr,
+                     unsigned threads)
+    : UndoBlock(mr)
+{
+    reparse(raw, prev_block_hash, threads);
+}
+
+UndoBlock::UndoBlock(std::pmr::memory_resource *mr)
+    : magic(0), undoPayloadSize(0), txCount(0), txStarts(mr), transactions(mr),
+      pubkeyCoins(mr), pubkeyYs(mr), pubkeyMisses(mr)
+{
+}
+
+void UndoBlock::reparse(std::span<const uint8_t> raw, unsigned threads)
+{
+    std::pmr::memory_resource *mr = transactions.get_allocator().resource();
+
+    liveTxs = 0;
+    txStarts.clear();
+
+    ByteReader<CheckedBounds> r(raw, 0, "UndoBlock");
+
+    magic = r.u32("magic");
+    undoPayloadSize = r.u32("size");
+
+    if (r.remaining() < static_cast<size_t>(undoPayloadSize) + 32)
+        throw std::runtime_error("UndoBlock truncated");
+
+    size_t payloadEnd = r.offset() + undoPayloadSize;
+
+    txCount = r.varint("tx count");
+
+    // Same two passes as Block: find where each undo tx starts, then
+    // decode them in parallel
+    txStarts.reserve(std::min<uint64_t>(txCount, r.remaining()));
+
+    size_t off = r.offset();
+    for (uint64_t i = 0; i < txCount; ++i)
     {
-        UndoCoin coin;
+        txStarts.push_back(off);
+        off = skip_undo_tx(raw, off);
+    }
 
-        uint64_t code = read_cvarint(data, off);
-        coin.height = code >> 1;
-        coin.isCoinbase = code & 1;
+    if (off != payloadEnd)
+        throw std::runtime_error("UndoBlock payload size mismatch");
 
-        if (coin.height > 0)
+    if (!sharedMr && parallel_for_threads(txStarts.size(), threads, MIN_TXS_PER_THREAD) > 1)
+    {
+        transactions.clear();
+        sharedMr = std::make_unique<std::pmr::synchronized_pool_resource>(mr);
+    }
+    std::pmr::memory_resource *tx_mr = sharedMr ? sharedMr.get() : mr;
+
+    transactions.reserve(txStarts.size());
+    while (transactions.size() < txStarts.size())
+        transactions.emplace_back(tx_mr);
+
+    parallel_for(txStarts.size(), threads, MIN_TXS_PER_THREAD, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
         {
-            if (off >= data.size())
-                throw std::runtime_error("dummy underflow");
-            uint8_t dummy = data[off++];
-            // should always be 0
+            size_t tx_off = txStarts[i];
+            transactions[i].parse(raw, tx_off);
         }
-        // CompressedAmount (CVarInt)
-        uint64_t compressed = read_cvarint(data, off);
-        coin.value = decompress_amount(compressed);
+    });
 
-        // CompressedScript (type CVarInt + data bytes)
-        uint64_t script_type = read_cvarint(data, off);
-        coin.scriptPubKey = decompress_script(script_type, data, off);
+    std::copy(raw.begin() + off, raw.begin() + off + 32, checksum.begin());
+    liveTxs = txStarts.size();
+}
 
-        spentOutputs.push_back(std::move(coin));
+void UndoBlock::reparse(std::span<const uint8_t> raw,
+                        const std::array<uint8_t, 32> &prev_block_hash,
+                        unsigned threads)
+{
+    reparse(raw, threads);
+    if (!checksum_matches(raw, prev_block_hash))
+    {
+        liveTxs = 0;
+        throw std::runtime_error("UndoBlock checksum mismatch");
     }
 }
 
-// UndoBlock
-
-UndoBlock::UndoBlock(std::vector<uint8_t> &raw)
+void UndoBlock::decompress_pubkeys(PubkeyCache &cache, unsigned threads)
 {
-    size_t off = 0;
+    pubkeyCoins.clear();
+    pubkeyYs.clear();
+    pubkeyMisses.clear();
 
-    magic = read_uint32_le(raw, off);
-    off += 4;
+    auto x_of = [](const UndoCoin *coin) { return coin->scriptPubKey.payload().first<32>(); };
+    auto odd = [](const UndoCoin *coin) { return coin->scriptPubKey.type() == 5; };
 
-    undoPayloadSize = read_uint32_le(raw, off);
-    off += 4;
+    for (size_t t = 0; t < liveTxs; ++t)
+    {
+        UndoTx &tx = transactions[t];
+        for (size_t i = 0; i < tx.inputCount; ++i)
+        {
+            UndoCoin *coin = &tx.spentOutputs[i];
+            if (!coin->scriptPubKey.needs_pubkey_y())
+                continue;
 
-    if (off + undoPayloadSize > raw.size())
-        throw std::runtime_error("UndoBlock truncated");
+            if (!cache.find(x_of(coin), odd(coin), pubkeyYs.emplace_back()))
+                pubkeyMisses.push_back(pubkeyCoins.size());
+            pubkeyCoins.push_back(coin);
+        }
+    }
 
-    size_t payloadEnd = off + undoPayloadSize;
+    // A key spent more than once in the block is computed once: with the
+    // misses sorted by key only the first of each run is computed, the
+    // others copy it afterwards
+    auto less = [&](size_t a, size_t b)
+    {
+        const CompressedScript &sa = pubkeyCoins[a]->scriptPubKey;
+        const CompressedScript &sb = pubkeyCoins[b]->scriptPubKey;
+        if (sa.type() != sb.type())
+            return sa.type() < sb.type();
+        return std::ranges::lexicographical_compare(sa.payload(), sb.payload());
+    };
+    auto same_key = [&](size_t a, size_t b) { return !less(a, b) && !less(b, a); };
 
-    txCount = read_varint(raw, off);
+    std::sort(pubkeyMisses.begin(), pubkeyMisses.end(), less);
 
-    transactions.reserve(txCount);
+    parallel_for(pubkeyMisses.size(), threads, MIN_PUBKEYS_PER_THREAD, [&](size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; ++k)
+        {
+            if (k > 0 && same_key(pubkeyMisses[k - 1], pubkeyMisses[k]))
+                continue;
 
-    for (uint64_t i = 0; i < txCount; ++i)
-        transactions.emplace_back(raw, off);
+            const UndoCoin *coin = pubkeyCoins[pubkeyMisses[k]];
+            pubkeyYs[pubkeyMisses[k]] = decompress_pubkey_y(x_of(coin), odd(coin));
+        }
+    });
 
-    if (off != payloadEnd)
-        throw std::runtime_error("UndoBlock payload size mismatch");
+    for (size_t k = 0; k < pubkeyMisses.size(); ++k)
+    {
+        size_t miss = pubkeyMisses[k];
+        if (k > 0 && same_key(pubkeyMisses[k - 1], miss))
+            pubkeyYs[miss] = pubkeyYs[pubkeyMisses[k - 1]];
+        else
+            cache.insert(x_of(pubkeyCoins[miss]), pubkeyYs[miss]);
+    }
+
+    for (size_t k = 0; k < pubkeyCoins.size(); ++k)
+        pubkeyCoins[k]->scriptPubKey.set_pubkey_y(pubkeyYs[k]);
+}
+
+// Bitcoin Core writes HASH256(hashPrevBlock || CBlockUndo) after each undo
+// record, so the checksum ties a rev record to exactly one block
+bool UndoBlock::checksum_matches(std::span<const uint8_t> raw,
+                                 const std::array<uint8_t, 32> &prev_block_hash)
+{
+    if (raw.size() < 8)
+        return false;
+
+    uint32_t payload_size = read_uint32_le(raw, 4);
+    if (8 + static_cast<size_t>(payload_size) + 32 > raw.size())
+        return false;
+
+    std::array<uint8_t, 32> hash = Sha256Hasher()
+                                       .write(prev_block_hash)
+                                       .write(raw.subspan(8, payload_size))
+                                       .finalize_double();
 
-    // skip checksum (32 bytes), we dont need that ?
-    // but we should not skip this ?
-    off += 32;
+    return std::equal(hash.begin(), hash.end(), raw.begin() + 8 + payload_size);
 }
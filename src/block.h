@@ -2,9 +2,16 @@
 #define BLOCK_H
 
 #include "transaction.h"
+#include "transaction_view.h"
+#include "block_columns.h"
+#include "compressed_script.h"
+#include "pubkey_cache.h"
 #include "utilities.h"
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <array>
+#include <span>
 #include <cstdint>
 #include <string>
 #include <optional>
@@ -41,7 +48,7 @@ public:
     std::string getHashStr() const;
 
 protected:
-    void calcBlockHash();
+    void calcBlockHash(std::span<const uint8_t, 80> raw);
 };
 
 // Block data structure
@@ -51,12 +58,48 @@ private:
     uint32_t magic, blockSize;
     BlockHeader blockHeader;
     uint64_t txnCounter;
-    std::vector<Transaction> txs;
+
+    // Set once transactions were parsed on several threads, from then on
+    // their tables come from here (on top of mr) instead of mr directly
+    std::unique_ptr<std::pmr::synchronized_pool_resource> sharedMr;
+
+    // Byte ranges of every transaction, from the boundary pass
+    std::pmr::vector<TxByteRanges> txRanges;
+
+    // The first liveTxs are this block's transactions, the rest are kept
+    // with their tables' capacity for the next reparse()
+    std::pmr::vector<TransactionView> txs;
+    size_t liveTxs = 0;
+
+    BlockColumns columns;
 
 public:
     // Constructor that takes in a single block hex bytes and build the block data structure
     // blk_hex_bytes : [magic bytes] [payload size] [payload]
-    Block(std::vector<uint8_t> &blk_hex_bytes);
+    // Parsed in place, the bytes can be a view into a mapped blk file.
+    // Transactions are views into these bytes, so they must outlive the Block
+    // Per transaction tables are allocated from mr (e.g. a BlockArena)
+    // A first pass only finds the transaction boundaries, then they are
+    // parsed and hashed on up to threads threads (0 = one per hardware
+    // thread); small blocks stay on the calling thread. mr is only used
+    // from the calling thread.
+    Block(std::span<const uint8_t> blk_hex_bytes,
+          std::pmr::memory_resource *mr = std::pmr::get_default_resource(),
+          unsigned threads = 1);
+
+    // Empty block to reparse() into
+    explicit Block(std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // Replaces the contents with another block, as the constructor would,
+    // but keeps every vector's capacity and the transaction objects: once
+    // blocks of that size have been seen this allocates nothing. Keep the
+    // memory resource alive across calls (not a BlockArena that is reset).
+    // After a throw the block is empty.
+    // txids: the display order txids of every transaction, if the caller
+    // already hashed them (e.g. for a merkle check), so they are not
+    // hashed again. Empty = hash them here.
+    void reparse(std::span<const uint8_t> blk_hex_bytes, unsigned threads = 1,
+                 std::span<const std::array<uint8_t, 32>> txids = {});
 
     // getters for pvt variables
     uint32_t getMagicNumber() const;
@@ -66,11 +109,21 @@ public:
 
     uint64_t getOutputsValue() const;
 
-    const std::vector<Transaction> &getTransactions() const;
+    std::span<const TransactionView> getTransactions() const;
+
+    // Per tx / output / input numbers as flat arrays, built with txs
+    const BlockColumns &getColumns() const { return columns; }
 
     std::vector<uint8_t> calcMerkleRoot() const;
 };
 
+// Merkle root over txids in internal byte order (reverse_32 of the display
+// order txid), 32 zero bytes if there are none
+std::vector<uint8_t> merkle_root(std::vector<std::array<uint8_t, 32>> txids);
+
+// Block height a coinbase scriptSig starts with (BIP 34), 0 if it does not
+uint32_t bip34_height(std::span<const uint8_t> coinbase_script_sig);
+
 // Data structures for rev files
 
 // Prevout structure
@@ -79,25 +132,39 @@ struct UndoCoin {
     uint32_t height;
     bool isCoinbase;
     uint64_t value;
-    std::vector<uint8_t> scriptPubKey;
+    CompressedScript scriptPubKey; // as stored, decompress() for the full script
 };
 
 class UndoTx
 {
 private:
     uint64_t inputCount; // CompactSize
-    std::vector<UndoCoin> spentOutputs;
+
+    // The first inputCount are this tx's coins, parse() reuses the rest
+    std::pmr::vector<UndoCoin> spentOutputs;
 
 public:
-    UndoTx(std::vector<uint8_t> &data, size_t &offset);
+    // Coins and their scripts are allocated from mr
+    UndoTx(std::span<const uint8_t> data, size_t &offset,
+           std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // Empty, filled by parse()
+    explicit UndoTx(std::pmr::memory_resource *mr = std::pmr::get_default_resource());
 
-    const std::vector<UndoCoin>& getInputs() const {
-        return spentOutputs;
+    // Replaces the contents with the undo tx at offset, leaves offset past
+    // it. Coins (and their scripts' capacity) are reused.
+    void parse(std::span<const uint8_t> data, size_t &offset);
+
+    std::span<const UndoCoin> getInputs() const {
+        return {spentOutputs.data(), static_cast<size_t>(inputCount)};
     }
 
     uint64_t getInputCount() const {
         return inputCount;
     }
+
+    // Hands the coins' pubkey y out (UndoBlock::decompress_pubkeys)
+    friend class UndoBlock;
 };
 
 class UndoBlock
@@ -107,13 +174,64 @@ private:
     uint32_t undoPayloadSize;
     uint64_t txCount;  // number of non-coinbase txs
 
-    std::vector<UndoTx> transactions;
+    // Same as in Block
+    std::unique_ptr<std::pmr::synchronized_pool_resource> sharedMr;
+    std::pmr::vector<size_t> txStarts;
+    std::pmr::vector<UndoTx> transactions;
+    size_t liveTxs = 0;
+
+    // From decompress_pubkeys(): every type 4/5 coin, its y and which of
+    // them were not cached
+    std::pmr::vector<UndoCoin *> pubkeyCoins;
+    std::pmr::vector<std::array<uint8_t, 32>> pubkeyYs;
+    std::pmr::vector<size_t> pubkeyMisses;
+
+    // HASH256(prev block hash || payload), as stored after the payload
+    std::array<uint8_t, 32> checksum;
 
 public:
-    UndoBlock(std::vector<uint8_t> &bytes);
+    // bytes : [magic] [payload size] [payload] [checksum], parsed in place
+    // Checksum is kept but not verified
+    // Undo txs and coins are allocated from mr (e.g. a BlockArena)
+    // Undo txs are decoded on up to threads threads, as in Block
+    UndoBlock(std::span<const uint8_t> bytes,
+              std::pmr::memory_resource *mr = std::pmr::get_default_resource(),
+              unsigned threads = 1);
+
+    // Same as above but throws if the checksum does not commit to
+    // prev_block_hash (header prevBlock of the block this undo belongs to)
+    UndoBlock(std::span<const uint8_t> bytes,
+              const std::array<uint8_t, 32> &prev_block_hash,
+              std::pmr::memory_resource *mr = std::pmr::get_default_resource(),
+              unsigned threads = 1);
+
+    // Empty undo block to reparse() into
+    explicit UndoBlock(std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // Same as Block::reparse, for the two constructors above
+    void reparse(std::span<const uint8_t> bytes, unsigned threads = 1);
+    void reparse(std::span<const uint8_t> bytes,
+                 const std::array<uint8_t, 32> &prev_block_hash,
+                 unsigned threads = 1);
+
+    // Computes the y coordinate of every type 4/5 (uncompressed P2PK) coin
+    // in one batch, so decompressing their scripts later costs no secp256k1
+    // call. Keys found in cache are taken from it, the rest are computed on
+    // up to threads threads and added to it. Throws if a coin's x is not on
+    // the curve. Needed again after every reparse().
+    void decompress_pubkeys(PubkeyCache &cache, unsigned threads = 1);
+
+    // True if the record's checksum matches prev_block_hash
+    // Only hashes the payload, does not decode it
+    static bool checksum_matches(std::span<const uint8_t> bytes,
+                                 const std::array<uint8_t, 32> &prev_block_hash);
+
+    const std::array<uint8_t, 32>& getChecksum() const {
+        return checksum;
+    }
 
-    const std::vector<UndoTx>& getTransactions() const {
-        return transactions;
+    std::span<const UndoTx> getTransactions() const {
+        return {transactions.data(), liveTxs};
     }
 
     uint64_t getTxCount() const {
@@ -0,0 +1,44 @@
+#include "block_arena.h"
+
+void *CountingResource::do_allocate(size_t n, size_t align)
+{
+    allocations++;
+    bytes += n;
+    return upstream_->allocate(n, align);
+}
+
+void CountingResource::do_deallocate(void *p, size_t n, size_t align)
+{
+    upstream_->deallocate(p, n, align);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+BlockArena::BlockArena(size_t initial_size)
+    : buffer_(new std::byte[initial_size]),
+      size_(initial_size)
+{
+    pool_.emplace(buffer_.get(), size_, &overflow_);
+}
+
+void BlockArena::reset()
+{
+    // Hands the overflow chunks back to the heap
+    pool_->release();
+
+    if (overflow_.bytes > 0)
+    {
+        // Grow to what the last block needed in total; the pool is rebuilt
+        // in place, so resource() does not change
+        size_ += overflow_.bytes;
+        pool_.reset();
+        buffer_.reset(new std::byte[size_]);
+        regrowths_++;
+        pool_.emplace(buffer_.get(), size_, &overflow_);
+    }
+
+    overflow_.bytes = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef BLOCK_ARENA_H
+#define BLOCK_ARENA_H
+
+#include <memory_resource>
+#include <memory>
+#include <optional>
+#include <cstddef>
+
+// Passes allocations on to upstream and counts them
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream)
+    {
+    }
+
+    size_t allocations = 0; // allocate() calls
+    size_t bytes = 0;       // bytes handed out, deallocations not subtracted
+
+private:
+    void *do_allocate(size_t n, size_t align) override;
+    void do_deallocate(void *p, size_t n, size_t align) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    std::pmr::memory_resource *upstream_;
+};
+
+// Memory for everything built from one block: the Block's transaction
+// views, the UndoBlock's coins and the BlockAnalyzer's results. Allocating
+// is a pointer bump and nothing is freed on its own, reset() drops it all
+// at once before the next block. What a block needed beyond the buffer
+// comes from the heap and is added to the buffer on the next reset, so once
+// the biggest block so far has been seen a block costs no malloc at all.
+// Not thread safe, every BlockParser has its own.
+class BlockArena
+{
+public:
+    explicit BlockArena(size_t initial_size = 4 * 1024 * 1024);
+
+    BlockArena(const BlockArena &) = delete;
+    BlockArena &operator=(const BlockArena &) = delete;
+
+    // The same pointer for the arena's whole life
+    std::pmr::memory_resource *resource() { return &*pool_; }
+
+    // Releases everything allocated from resource(), none of it may still
+    // be in use
+    void reset();
+
+    // Size of the reused buffer
+    size_t capacity() const { return size_; }
+
+    // Bytes taken from the heap since the last reset because the buffer
+    // was full
+    size_t overflow_bytes() const { return overflow_.bytes; }
+
+    // Heap allocations over the arena's life: overflow chunks and buffer
+    // regrowths. Stops changing once the buffer fits the biggest block.
+    size_t heap_allocations() const { return overflow_.allocations + regrowths_; }
+
+private:
+    std::unique_ptr<std::byte[]> buffer_;
+    size_t size_;
+    size_t regrowths_ = 0;
+    CountingResource overflow_; // upstream of the pool
+    std::optional<std::pmr::monotonic_buffer_resource> pool_;
+};
+
+#endif
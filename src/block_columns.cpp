@@ -0,0 +1,87 @@
+#include "block_columns.h"
+
+BlockColumns::BlockColumns(std::pmr::memory_resource *mr)
+    : tx_first_output(mr), tx_first_input(mr), tx_size(mr), tx_weight(mr), tx_vbytes(mr),
+      output_amount(mr), output_script_offset(mr), output_script_size(mr), output_script_type(mr),
+      input_prevout_index(mr)
+{
+}
+
+void BlockColumns::add(const TransactionView &tx, std::span<const uint8_t> record)
+{
+    tx_first_output.push_back(static_cast<uint32_t>(output_amount.size()));
+    tx_first_input.push_back(static_cast<uint32_t>(input_prevout_index.size()));
+    tx_size.push_back(static_cast<uint32_t>(tx.get_size_bytes()));
+    tx_weight.push_back(static_cast<uint32_t>(tx.get_weight()));
+    tx_vbytes.push_back(static_cast<uint32_t>(tx.get_vbytes()));
+
+    for (const TxOutView &out : tx.outputs)
+    {
+        output_amount.push_back(out.amount);
+        output_script_offset.push_back(static_cast<uint32_t>(out.scriptPubKey.data() - record.data()));
+        output_script_size.push_back(static_cast<uint32_t>(out.scriptPubKey.size()));
+        output_script_type.push_back(static_cast<uint8_t>(classify_output_script(out.scriptPubKey)));
+    }
+
+    for (const TxInView &in : tx.inputs)
+        input_prevout_index.push_back(in.vout);
+}
+
+void BlockColumns::clear()
+{
+    tx_first_output.clear();
+    tx_first_input.clear();
+    tx_size.clear();
+    tx_weight.clear();
+    tx_vbytes.clear();
+    output_amount.clear();
+    output_script_offset.clear();
+    output_script_size.clear();
+    output_script_type.clear();
+    input_prevout_index.clear();
+}
+
+size_t BlockColumns::output_end(size_t i) const
+{
+    return i + 1 < tx_first_output.size() ? tx_first_output[i + 1] : output_amount.size();
+}
+
+std::span<const uint8_t> BlockColumns::output_types(size_t i) const
+{
+    return std::span<const uint8_t>(output_script_type).subspan(output_begin(i), output_end(i) - output_begin(i));
+}
+
+// The sums below are plain loops over contiguous arrays, which the compiler
+// vectorizes
+
+uint64_t BlockColumns::total_output_value() const
+{
+    uint64_t total = 0;
+    for (uint64_t amount : output_amount)
+        total += amount;
+    return total;
+}
+
+uint64_t BlockColumns::total_weight() const
+{
+    uint64_t total = 0;
+    for (uint32_t w : tx_weight)
+        total += w;
+    return total;
+}
+
+uint64_t BlockColumns::total_vbytes() const
+{
+    uint64_t total = 0;
+    for (uint32_t vb : tx_vbytes)
+        total += vb;
+    return total;
+}
+
+std::array<uint64_t, OUTPUT_SCRIPT_TYPE_COUNT> BlockColumns::script_type_counts() const
+{
+    std::array<uint64_t, OUTPUT_SCRIPT_TYPE_COUNT> counts{};
+    for (uint8_t type : output_script_type)
+        counts[type]++;
+    return counts;
+}
@@ -0,0 +1,66 @@
+#ifndef BLOCK_COLUMNS_H
+#define BLOCK_COLUMNS_H
+
+#include "transaction_view.h"
+#include "script.h"
+#include <vector>
+#include <array>
+#include <span>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+
+// Number of OutputScriptType values, for per type counters
+constexpr size_t OUTPUT_SCRIPT_TYPE_COUNT = static_cast<size_t>(OutputScriptType::UNKNOWN) + 1;
+
+// Struct-of-arrays copy of the numbers block wide passes need, filled by
+// Block while it parses its transactions. Sums and per type counts run over
+// these dense arrays instead of walking every TransactionView's vectors.
+// Outputs and inputs of all transactions are stored back to back in block
+// order, tx_first_output / tx_first_input say where each tx starts.
+struct BlockColumns
+{
+    // per transaction
+    std::pmr::vector<uint32_t> tx_first_output;
+    std::pmr::vector<uint32_t> tx_first_input;
+    std::pmr::vector<uint32_t> tx_size;
+    std::pmr::vector<uint32_t> tx_weight;
+    std::pmr::vector<uint32_t> tx_vbytes;
+
+    // per output
+    std::pmr::vector<uint64_t> output_amount;
+    std::pmr::vector<uint32_t> output_script_offset; // from the start of the block record
+    std::pmr::vector<uint32_t> output_script_size;
+    std::pmr::vector<uint8_t> output_script_type;    // OutputScriptType
+
+    // per input, vout of the output it spends
+    std::pmr::vector<uint32_t> input_prevout_index;
+
+    explicit BlockColumns(std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // Appends one transaction; record is the buffer tx was parsed from
+    void add(const TransactionView &tx, std::span<const uint8_t> record);
+
+    // Empties every column, keeping the capacity
+    void clear();
+
+    size_t tx_count() const { return tx_size.size(); }
+    size_t output_count() const { return output_amount.size(); }
+    size_t input_count() const { return input_prevout_index.size(); }
+
+    // Outputs of transaction i
+    size_t output_begin(size_t i) const { return tx_first_output[i]; }
+    size_t output_end(size_t i) const;
+
+    // output_script_type of transaction i's outputs
+    std::span<const uint8_t> output_types(size_t i) const;
+
+    uint64_t total_output_value() const;
+    uint64_t total_weight() const;
+    uint64_t total_vbytes() const;
+
+    // Outputs per OutputScriptType, indexed by the enum value
+    std::array<uint64_t, OUTPUT_SCRIPT_TYPE_COUNT> script_type_counts() const;
+};
+
+#endif
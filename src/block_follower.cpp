@@ -0,0 +1,337 @@
+#include "block_follower.h"
+#include "block.h"
+#include "lazy_block.h"
+#include "utilities.h"
+#include "mapped_file.h"
+#include "record_scanner.h"
+#include "byte_reader.h"
+
+#include <filesystem>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+namespace fs = std::filesystem;
+
+// How often to look for changes when inotify is not available
+static constexpr auto POLL_INTERVAL = std::chrono::seconds(2);
+
+// "blk00123.dat" / "rev00123.dat" -> 123, false for anything else
+static bool parse_file_number(const std::string &name, unsigned &n)
+{
+    std::optional<unsigned> num = dat_file_number(name, "blk");
+    if (!num)
+        num = dat_file_number(name, "rev");
+    if (!num)
+        return false;
+    n = *num;
+    return true;
+}
+
+BlocksDirFollower::BlocksDirFollower(const std::string &blocks_dir,
+                                     const std::string &out_dir)
+    : blocks_dir_(blocks_dir),
+      out_dir_(out_dir)
+{
+    if (!fs::is_directory(blocks_dir_))
+        throw std::runtime_error("Not a directory: " + blocks_dir_);
+
+    xor_path_ = blocks_dir_xor_path(blocks_dir_);
+    if (!xor_path_.empty())
+        xor_key_ = read_xor_key(xor_path_);
+
+    fs::create_directories(out_dir_);
+}
+
+std::string BlocksDirFollower::blk_path(unsigned n) const
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "blk%05u.dat", n);
+    return (fs::path(blocks_dir_) / name).string();
+}
+
+std::string BlocksDirFollower::rev_path(unsigned n) const
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "rev%05u.dat", n);
+    return (fs::path(blocks_dir_) / name).string();
+}
+
+FollowedFile &BlocksDirFollower::state(unsigned n)
+{
+    auto it = files_.find(n);
+    if (it != files_.end())
+        return it->second;
+
+    FollowedFile &f = files_[n];
+
+    // Already on disk when we started: skip what is there without reports,
+    // but keep blocks still waiting for their undo data
+    if (existing_.erase(n))
+    {
+        consume_blk(n, f);
+        consume_rev(n, f, false);
+    }
+
+    return f;
+}
+
+void BlocksDirFollower::consume_blk(unsigned n, FollowedFile &f)
+{
+    if (!fs::exists(blk_path(n)))
+        return;
+
+    MappedFile blk_file(blk_path(n));
+    RecordScanner scanner = RecordScanner::for_blk(blk_file, xor_key_);
+    scanner.seek(f.blk_offset);
+
+    std::vector<uint8_t> scratch;
+    std::vector<size_t> unverified; // offsets of records that did not check out
+    DatRecord rec;
+
+    while (scanner.next(rec))
+    {
+        std::span<const uint8_t> record =
+            load_range(blk_file, rec.offset, rec.size, xor_key_, scratch);
+
+        // A block that is still being written does not decode, or decodes
+        // from zero fill into transactions that do not hash to the root
+        PendingBlock pb;
+        BlkRecordInfo &info = pb.info;
+        bool complete = false;
+        try
+        {
+            // Only the txids are needed, no transaction is decoded
+            LazyBlock block(record);
+            BlockHeader hdr = block.getHeader();
+            std::vector<uint8_t> root = block.calcMerkleRoot(&pb.txids);
+            std::array<uint8_t, 32> header_root = hdr.getMerkleRoot();
+
+            complete = std::equal(root.begin(), root.end(), header_root.begin());
+
+            info.offset = rec.offset;
+            info.size = rec.size;
+            info.block_hash = hdr.getBlockHash();
+            info.prev_hash = hdr.getPreviousBlock();
+            info.tx_count = block.getTransactionCount();
+        }
+        catch (const std::exception &)
+        {
+        }
+
+        if (!complete)
+        {
+            unverified.push_back(rec.offset);
+            continue;
+        }
+
+        // Something complete follows, so those were not tail records after all
+        for (size_t off : unverified)
+        {
+            std::cerr << "[skip] " << fs::path(blk_path(n)).filename().string()
+                      << " offset=" << off << " corrupt record\n";
+            stats_.records_skipped++;
+        }
+        unverified.clear();
+
+        f.pending.push_back(std::move(pb));
+        f.blk_offset = rec.offset + rec.size;
+    }
+}
+
+size_t BlocksDirFollower::consume_rev(unsigned n, FollowedFile &f, bool write)
+{
+    if (f.pending.empty() || !fs::exists(rev_path(n)))
+        return 0;
+
+    MappedFile rev_file(rev_path(n));
+    RecordScanner scanner = RecordScanner::for_rev(rev_file, xor_key_);
+    scanner.seek(f.rev_offset);
+
+    std::vector<uint8_t> scratch;
+    std::vector<size_t> unmatched;
+    size_t written = 0;
+    DatRecord rec;
+
+    while (!f.pending.empty() && scanner.next(rec))
+    {
+        std::span<const uint8_t> record =
+            load_range(rev_file, rec.offset, rec.size, xor_key_, scratch);
+
+        // A short payload can end inside its tx count, which then must not
+        // be read out of the checksum behind it
+        uint64_t undo_count;
+        try
+        {
+            ByteReader<CheckedBounds> r(record.first(record.size() - 32), 8, "UndoBlock");
+            undo_count = r.varint("tx count");
+        }
+        catch (const std::runtime_error &)
+        {
+            unmatched.push_back(rec.offset);
+            continue;
+        }
+
+        // The checksum only matches once the whole record is on disk
+        auto it = std::find_if(f.pending.begin(), f.pending.end(),
+                               [&](const PendingBlock &b)
+                               {
+                                   return b.info.tx_count == undo_count + 1 &&
+                                          UndoBlock::checksum_matches(record, b.info.prev_hash);
+                               });
+
+        if (it == f.pending.end())
+        {
+            unmatched.push_back(rec.offset);
+            continue;
+        }
+
+        for (size_t off : unmatched)
+        {
+            std::cerr << "[skip] " << fs::path(rev_path(n)).filename().string()
+                      << " offset=" << off << " unmatched undo record\n";
+            stats_.records_skipped++;
+        }
+        unmatched.clear();
+
+        PendingBlock pb = std::move(*it);
+        const BlkRecordInfo &info = pb.info;
+        f.pending.erase(it);
+        f.rev_offset = rec.offset + rec.size;
+
+        if (!write)
+            continue;
+
+        try
+        {
+            BlockParser parser(blk_path(n), rev_path(n), xor_path_, out_dir_);
+            parser.set_verbose(false);
+            parser.set_workspace(std::move(workspace_));
+            // Checksum verified and txids hashed above, neither is redone
+            parser.run_at_matched(info.offset, rec.offset, pb.txids);
+            workspace_ = parser.take_workspace();
+
+            std::cerr << "[follow] block=" << bytes_to_hex(info.block_hash)
+                      << " file=" << fs::path(blk_path(n)).filename().string()
+                      << " blk_offset=" << info.offset
+                      << " rev_offset=" << rec.offset << "\n";
+            stats_.blocks_written++;
+            written++;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[skip] block=" << bytes_to_hex(info.block_hash)
+                      << " parse error: " << e.what() << "\n";
+            stats_.blocks_failed++;
+        }
+    }
+
+    return written;
+}
+
+size_t BlocksDirFollower::poll(unsigned n)
+{
+    FollowedFile &f = state(n);
+    consume_blk(n, f);
+    return consume_rev(n, f, true);
+}
+
+void BlocksDirFollower::run(size_t max_blocks)
+{
+    for (const auto &entry : fs::directory_iterator(blocks_dir_))
+    {
+        unsigned n = 0;
+        if (parse_file_number(entry.path().filename().string(), n))
+            existing_.insert(n);
+    }
+
+    // bitcoind only appends to the newest pair, catch up with it right away
+    unsigned newest = existing_.empty() ? 0 : *existing_.rbegin();
+    if (!existing_.empty())
+    {
+        FollowedFile &f = state(newest);
+        std::cerr << "[follow] watching " << blocks_dir_
+                  << " from " << fs::path(blk_path(newest)).filename().string()
+                  << " blk_offset=" << f.blk_offset
+                  << " rev_offset=" << f.rev_offset
+                  << " pending=" << f.pending.size() << "\n";
+    }
+
+    auto done = [&]()
+    { return max_blocks > 0 && stats_.blocks_written >= max_blocks; };
+
+    int fd = ::inotify_init1(IN_CLOEXEC);
+    if (fd >= 0 &&
+        ::inotify_add_watch(fd, blocks_dir_.c_str(),
+                            IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0)
+    {
+        // No inotify (limits, container policy): look at the newest pair
+        // every POLL_INTERVAL and move on once the next one shows up
+        std::cerr << "[follow] inotify unavailable, polling\n";
+        while (!done())
+        {
+            poll(newest);
+            if (fs::exists(blk_path(newest + 1)))
+                newest++;
+            else
+                std::this_thread::sleep_for(POLL_INTERVAL);
+        }
+        return;
+    }
+
+    alignas(inotify_event) char buf[64 * 1024];
+
+    while (!done())
+    {
+        ssize_t len = ::read(fd, buf, sizeof(buf));
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("inotify read failed");
+        }
+
+        // One pass per touched file pair, however many events it produced
+        std::set<unsigned> touched;
+        bool overflow = false;
+
+        for (char *p = buf; p < buf + len;)
+        {
+            auto *ev = reinterpret_cast<inotify_event *>(p);
+            unsigned n = 0;
+
+            if (ev->mask & IN_Q_OVERFLOW)
+                overflow = true;
+            else if (ev->len > 0 && parse_file_number(ev->name, n))
+                touched.insert(n);
+
+            p += sizeof(inotify_event) + ev->len;
+        }
+
+        // Events were dropped, recheck everything we know about
+        if (overflow)
+            for (const auto &entry : files_)
+                touched.insert(entry.first);
+
+        for (unsigned n : touched)
+        {
+            poll(n);
+            if (done())
+                break;
+        }
+    }
+
+    ::close(fd);
+}
@@ -0,0 +1,86 @@
+#ifndef BLOCK_FOLLOWER_H
+#define BLOCK_FOLLOWER_H
+
+#include "block_parser.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <set>
+#include <cstdint>
+#include <cstddef>
+
+// Complete block waiting for its undo record. The txids were hashed for
+// the merkle check that showed the record complete, and are reused for
+// the report.
+struct PendingBlock
+{
+    BlkRecordInfo info;
+    std::vector<std::array<uint8_t, 32>> txids;
+};
+
+// Follow state of one blkNNNNN.dat/revNNNNN.dat pair
+struct FollowedFile
+{
+    size_t blk_offset = 0; // end of the last complete blk record consumed
+    size_t rev_offset = 0; // end of the last rev record matched to a block
+
+    // Complete blocks whose undo record has not been written yet
+    std::vector<PendingBlock> pending;
+};
+
+// Counters for a follow session
+struct FollowStats
+{
+    size_t blocks_written = 0;  // reports written for newly appended blocks
+    size_t blocks_failed = 0;   // complete pairs that still did not decode
+    size_t records_skipped = 0; // corrupt records passed over mid file
+};
+
+// Tails a live bitcoind blocks directory: watches it with inotify and, as
+// bitcoind appends, writes a report for every block whose blk and rev records
+// are both complete. A record that is still being written (past EOF, zero
+// filled, checksum or merkle root not matching yet) is simply retried on the
+// next change, only once a later record completes is it treated as corrupt.
+class BlocksDirFollower
+{
+public:
+    BlocksDirFollower(const std::string &blocks_dir,
+                      const std::string &out_dir = "out");
+
+    // Catches up with the newest file pair without writing reports, then
+    // follows until max_blocks reports were written (0 = forever)
+    void run(size_t max_blocks = 0);
+
+    // One pass over file pair number n, returns the reports written
+    size_t poll(unsigned n);
+
+    const FollowStats &stats() const { return stats_; }
+
+private:
+    std::string blk_path(unsigned n) const;
+    std::string rev_path(unsigned n) const;
+
+    // State for file pair n, created on first use. Pairs that existed when
+    // following started are caught up silently first.
+    FollowedFile &state(unsigned n);
+
+    // New complete blk records -> pending, new rev records -> reports
+    void consume_blk(unsigned n, FollowedFile &f);
+    size_t consume_rev(unsigned n, FollowedFile &f, bool write);
+
+    std::string blocks_dir_;
+    std::string out_dir_;
+    std::string xor_path_;
+    std::vector<uint8_t> xor_key_;
+
+    std::map<unsigned, FollowedFile> files_;
+    std::set<unsigned> existing_; // pairs present at start, not yet caught up
+    FollowStats stats_;
+
+    // Kept warm from block to block, see BlockWorkspace
+    std::unique_ptr<BlockWorkspace> workspace_;
+};
+
+#endif
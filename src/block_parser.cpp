@@ -3,39 +3,71 @@
 #include "accounting.h"
 #include "json_helper.h"
 #include "utilities.h"
+#include "mapped_file.h"
+#include "record_scanner.h"
+#include "direct_reader.h"
+#include "record_stream.h"
+#include "byte_reader.h"
 
 #include <filesystem>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
 // ---------------- DatFileReader ----------------
 
 DatFileReader::DatFileReader(const std::string &path,
-                             const std::vector<uint8_t> &xor_key)
-    : stream_(path, std::ios::binary),
+                             const std::vector<uint8_t> &xor_key,
+                             bool direct)
+    : stream_(&file_),
       xor_key_(xor_key),
       file_offset_(0)
 {
-    if (!stream_.is_open())
+    if (path == "-")
+    {
+        stream_ = &std::cin;
+        return;
+    }
+
+    if (direct)
+    {
+        direct_ = std::make_unique<DirectFileReader>(path);
+        return;
+    }
+
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open())
         throw std::runtime_error("Cannot open file: " + path);
 }
 
 bool DatFileReader::read_bytes(std::vector<uint8_t> &buf, size_t n)
 {
     buf.resize(n);
+    return read_some(std::span<uint8_t>(buf)) == n;
+}
 
-    if (!stream_.read(reinterpret_cast<char *>(buf.data()), n))
-        return false;
-
-    if (!xor_key_.empty())
+size_t DatFileReader::read_some(std::span<uint8_t> dst)
+{
+    size_t got;
+    if (direct_)
     {
-        for (size_t i = 0; i < n; ++i)
-            buf[i] ^= xor_key_[(file_offset_ + i) % xor_key_.size()];
+        got = direct_->read_some(dst);
+    }
+    else
+    {
+        stream_->read(reinterpret_cast<char *>(dst.data()), static_cast<std::streamsize>(dst.size()));
+        got = static_cast<size_t>(stream_->gcount());
     }
 
-    file_offset_ += n;
-    return true;
+    xor_decode(dst.first(got), xor_key_, file_offset_);
+
+    file_offset_ += got;
+    return got;
 }
 
 // ---------------- BlockParser ----------------
@@ -48,102 +80,796 @@ BlockParser::BlockParser(const std::string &blk_path,
       rev_path_(rev_path),
       out_dir_(out_dir)
 {
-    xor_key_ = read_xor_key(xor_path);
+    // Empty xor_path means the files are not obfuscated
+    if (!xor_path.empty())
+        xor_key_ = read_xor_key(xor_path);
     fs::create_directories(out_dir_);
 }
 
+void BlockParser::set_read_backend(ReadBackend backend, unsigned queue_depth)
+{
+    backend_ = backend;
+    queue_depth_ = queue_depth;
+}
+
+void BlockParser::prefetch()
+{
+    if (!cache_before_)
+        cache_before_ = page_cache_resident_bytes(blk_path_) + page_cache_resident_bytes(rev_path_);
+
+    if (backend_ != ReadBackend::IoUring)
+        return;
+
+    if (!blk_reader_ && !is_stream_path(blk_path_))
+        blk_reader_ = std::make_unique<AsyncFileReader>(blk_path_, queue_depth_);
+    if (!rev_reader_)
+        rev_reader_ = std::make_unique<AsyncFileReader>(rev_path_, queue_depth_);
+}
+
 size_t BlockParser::run()
 {
-    std::vector<uint8_t> blk_raw = read_file(blk_path_);
-    std::vector<uint8_t> rev_raw = read_file(rev_path_);
+    return walk(true);
+}
+
+size_t BlockParser::run_all()
+{
+    return walk(false);
+}
+
+BlockWorkspace &BlockParser::workspace()
+{
+    if (!workspace_)
+        workspace_ = std::make_unique<BlockWorkspace>();
+    return *workspace_;
+}
+
+// Reparses the workspace's Block and UndoBlock from the records and writes
+// the report. verify_checksum: make sure the undo record belongs to the block.
+// txids as for Block::reparse.
+void BlockParser::decode_pair(std::span<const uint8_t> blk_record,
+                              std::span<const uint8_t> rev_record,
+                              bool verify_checksum,
+                              std::span<const std::array<uint8_t, 32>> txids)
+{
+    BlockWorkspace &ws = workspace();
+    size_t allocations_before = ws.allocations();
+
+    // Nothing from the previous block is alive any more
+    ws.arena.reset();
+
+    ws.block.reparse(blk_record, decode_threads_, txids);
+    if (verify_checksum)
+        ws.undo.reparse(rev_record, ws.block.getHeader().getPreviousBlock(), decode_threads_);
+    else
+        ws.undo.reparse(rev_record, decode_threads_);
+    ws.undo.decompress_pubkeys(ws.pubkeys, decode_threads_);
+
+    if (verbose_)
+        std::cerr << "blk tx=" << ws.block.getTransactionCount()
+                  << " undo tx=" << ws.undo.getTxCount() << "\n";
+
+    write_report(ws.block, ws.undo);
+
+    size_t allocations = ws.allocations() - allocations_before;
+    stats_.decode_allocations += allocations;
+    if (allocations > 0)
+        stats_.blocks_allocating++;
+}
+
+void BlockParser::write_report(const Block &block, const UndoBlock &undo)
+{
+    BlockAnalyzer analyzer(block, undo, "mainnet", workspace().arena.resource());
+
+    std::string out_path =
+        out_dir_ + "/" +
+        analyzer.block_header.block_hash + ".json";
+
+    std::ofstream out(out_path);
+    if (!out)
+        throw std::runtime_error("Cannot open output");
+
+    out << block_to_json(analyzer).dump(4) << "\n";
+}
+
+// ---------------- Record indexing ----------------
+
+std::vector<BlkRecordInfo> scan_blk_records(const MappedFile &blk_file,
+                                            const std::vector<uint8_t> &xor_key,
+                                            std::vector<SkippedRange> *skipped)
+{
+    std::vector<BlkRecordInfo> records;
+    std::vector<uint8_t> scratch;
+    std::vector<SkippedRange> bad_records;
+
+    // prefix (8) + header (80) + tx count (max 9)
+    const size_t peek_len = 8 + 80 + 9;
+
+    RecordScanner scanner = RecordScanner::for_blk(blk_file, xor_key);
+    DatRecord rec;
+
+    while (scanner.next(rec))
+    {
+        std::span<const uint8_t> head =
+            load_range(blk_file, rec.offset, std::min(peek_len, rec.size), xor_key, scratch);
+
+        // The scanner guarantees the header, but a tx count prefix of 0xfd..0xff
+        // can still run past the end of a short record
+        uint64_t tx_count;
+        try
+        {
+            ByteReader<CheckedBounds> r(head, 88, "Block");
+            tx_count = r.varint("tx count");
+        }
+        catch (const std::runtime_error &)
+        {
+            bad_records.push_back({rec.offset, rec.size, "truncated block header"});
+            continue;
+        }
+
+        std::array<uint8_t, 80> hdr_bytes;
+        std::copy(head.begin() + 8, head.begin() + 88, hdr_bytes.begin());
+        BlockHeader hdr(hdr_bytes);
+
+        BlkRecordInfo info;
+        info.offset = rec.offset;
+        info.size = rec.size;
+        info.block_hash = hdr.getBlockHash();
+        info.prev_hash = hdr.getPreviousBlock();
+        info.header = hdr_bytes;
+        info.tx_count = tx_count;
+
+        records.push_back(info);
+    }
+
+    if (skipped)
+    {
+        *skipped = scanner.skipped();
+        skipped->insert(skipped->end(), bad_records.begin(), bad_records.end());
+        std::sort(skipped->begin(), skipped->end(),
+                  [](const SkippedRange &a, const SkippedRange &b) { return a.offset < b.offset; });
+    }
+
+    return records;
+}
+
+RevOffsetIndex build_rev_index(const MappedFile &rev_file,
+                               const std::vector<uint8_t> &xor_key,
+                               const std::vector<BlkRecordInfo> &blocks,
+                               size_t *unmatched,
+                               std::vector<SkippedRange> *skipped)
+{
+    // Candidate blocks per undo tx count, so each rev record is only hashed
+    // against blocks it could possibly belong to (usually exactly one)
+    std::unordered_multimap<uint64_t, size_t> by_undo_count;
+    for (size_t i = 0; i < blocks.size(); ++i)
+        if (blocks[i].tx_count > 0)
+            by_undo_count.emplace(blocks[i].tx_count - 1, i);
+
+    std::vector<bool> taken(blocks.size(), false);
+    RevOffsetIndex index;
+    std::vector<uint8_t> scratch;
+
+    if (unmatched)
+        *unmatched = 0;
+
+    RecordScanner scanner = RecordScanner::for_rev(rev_file, xor_key);
+    DatRecord rec;
+
+    while (scanner.next(rec))
+    {
+        std::span<const uint8_t> record =
+            load_range(rev_file, rec.offset, rec.size, xor_key, scratch);
+
+        size_t count_off = 8;
+        uint64_t undo_count = read_varint(record, count_off);
+
+        bool matched = false;
+        auto range = by_undo_count.equal_range(undo_count);
+        for (auto it = range.first; it != range.second && !matched; ++it)
+        {
+            size_t i = it->second;
+            if (taken[i] || !UndoBlock::checksum_matches(record, blocks[i].prev_hash))
+                continue;
+
+            taken[i] = true;
+            index[bytes_to_hex(blocks[i].block_hash)] = rec.offset;
+            matched = true;
+        }
+
+        if (!matched && unmatched)
+            (*unmatched)++;
+    }
+
+    if (skipped)
+        *skipped = scanner.skipped();
+
+    return index;
+}
+
+// Reads the full rev record starting at offset (already known to be in range)
+static std::span<const uint8_t> load_rev_record(const MappedFile &rev_file,
+                                                size_t offset,
+                                                const std::vector<uint8_t> &xor_key,
+                                                std::vector<uint8_t> &scratch)
+{
+    std::span<const uint8_t> prefix = load_range(rev_file, offset, 8, xor_key, scratch);
+    size_t total = 8 + static_cast<size_t>(read_uint32_le(prefix, 4)) + 32;
+    return load_range(rev_file, offset, total, xor_key, scratch);
+}
+
+// ---------------- Offset sidecar ----------------
+
+size_t write_offset_index(const std::string &index_path,
+                          const std::vector<BlkRecordInfo> &blocks,
+                          const RevOffsetIndex &rev_index)
+{
+    std::ofstream out(index_path);
+    if (!out)
+        throw std::runtime_error("Cannot open output: " + index_path);
+
+    out << "# block_hash blk_offset rev_offset\n";
+
+    size_t lines = 0;
+    for (const BlkRecordInfo &info : blocks)
+    {
+        std::string hash = bytes_to_hex(info.block_hash);
+        auto it = rev_index.find(hash);
+        if (it == rev_index.end())
+            continue;
+
+        out << hash << " " << info.offset << " " << it->second << "\n";
+        lines++;
+    }
+
+    if (!out)
+        throw std::runtime_error("Write error: " + index_path);
+
+    return lines;
+}
+
+std::optional<BlockOffsets> find_in_offset_index(const std::string &index_path,
+                                                 const std::string &block_hash)
+{
+    std::ifstream in(index_path);
+    if (!in)
+        throw std::runtime_error("Cannot open file: " + index_path);
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::string hash;
+        BlockOffsets offsets;
+        if (!(fields >> hash >> offsets.blk_offset >> offsets.rev_offset))
+            throw std::runtime_error("Malformed offset index line: " + line);
+
+        if (hash == block_hash)
+            return offsets;
+    }
+
+    return std::nullopt;
+}
+
+size_t BlockParser::build_offset_index(const std::string &index_path)
+{
+    MappedFile blk_file(blk_path_);
+    MappedFile rev_file(rev_path_);
+    blk_file.advise_sequential();
+    rev_file.advise_sequential();
+
+    std::vector<BlkRecordInfo> blocks = scan_blk_records(blk_file, xor_key_);
+    RevOffsetIndex rev_index = build_rev_index(rev_file, xor_key_, blocks);
+
+    return write_offset_index(index_path, blocks, rev_index);
+}
+
+// ---------------- Random access ----------------
+
+size_t BlockParser::run_at(size_t blk_offset, size_t rev_offset)
+{
+    // Offsets come from the user, so make sure the pair actually belongs together
+    return read_pair_at(blk_offset, rev_offset, true, {});
+}
+
+size_t BlockParser::run_at_matched(size_t blk_offset, size_t rev_offset,
+                                   std::span<const std::array<uint8_t, 32>> txids)
+{
+    return read_pair_at(blk_offset, rev_offset, false, txids);
+}
+
+size_t BlockParser::read_pair_at(size_t blk_offset, size_t rev_offset, bool verify_checksum,
+                                 std::span<const std::array<uint8_t, 32>> txids)
+{
+    stats_ = BlockParserStats{};
+
+    std::vector<uint8_t> blk_buf;
+    std::vector<uint8_t> rev_buf;
+    std::span<const uint8_t> blk_record = read_record_at(blk_path_, blk_offset, 0, xor_key_, blk_buf);
+    std::span<const uint8_t> rev_record = read_record_at(rev_path_, rev_offset, 32, xor_key_, rev_buf);
+
+    stats_.records_read = 1;
+    stats_.blk_bytes_parsed = blk_record.size();
+    stats_.rev_bytes_parsed = rev_record.size();
+
+    decode_pair(blk_record, rev_record, verify_checksum, txids);
+    stats_.blocks_written = 1;
+    return 1;
+}
+
+size_t BlockParser::run_hash(const std::string &block_hash, const std::string &index_path)
+{
+    std::optional<BlockOffsets> offsets = find_in_offset_index(index_path, block_hash);
+    if (!offsets)
+        throw std::runtime_error("Block not in offset index: " + block_hash);
+
+    return run_at(offsets->blk_offset, offsets->rev_offset);
+}
+
+// Gets one input file into memory with the configured backend
+std::unique_ptr<MappedFile> BlockParser::open_input(const std::string &path,
+                                                    std::unique_ptr<AsyncFileReader> &reader)
+{
+    std::unique_ptr<MappedFile> file;
+
+    switch (backend_)
+    {
+    case ReadBackend::IoUring:
+        stats_.read_backend = reader->uses_io_uring() ? "io_uring" : "pread";
+        file = std::make_unique<MappedFile>(path, reader->finish());
+        reader.reset();
+        break;
+
+    case ReadBackend::Direct:
+    {
+        DirectFileReader direct(path);
+        file = std::make_unique<MappedFile>(path, direct.read_all());
+        stats_.read_backend = direct.uses_o_direct() ? "direct" : "fadvise";
+        break;
+    }
 
-    if (!xor_key_.empty()) {
-        xor_decode(blk_raw, xor_key_);
-        xor_decode(rev_raw, xor_key_);
+    case ReadBackend::Mmap:
+        file = std::make_unique<MappedFile>(path);
+        file->advise_sequential();
+        break;
     }
 
-    size_t blk_off = 0;
-    size_t rev_off = 0;
+    stats_.bytes_read += file->size();
+    return file;
+}
 
-    while (blk_off < blk_raw.size() && rev_off < rev_raw.size())
+// Page cache footprint of both inputs, before (from prefetch() or the start
+// of walk()) and after the run
+void BlockParser::record_cache_after()
+{
+    stats_.cache_resident_before = cache_before_.value_or(0);
+    stats_.cache_resident_after =
+        page_cache_resident_bytes(blk_path_) + page_cache_resident_bytes(rev_path_);
+    cache_before_.reset();
+}
+
+// Decodes one paired blk/rev record and writes its report. A record that
+// frames fine but does not decode only costs us that block.
+bool BlockParser::parse_pair(const BlkRecordInfo &info,
+                             std::span<const uint8_t> blk_record,
+                             std::span<const uint8_t> rev_record)
+{
+    try
+    {
+        decode_pair(blk_record, rev_record, false);
+    }
+    catch (const std::exception &e)
     {
-        // ---------------- EXTRACT BLOCK RECORD ----------------
-        size_t blk_start = blk_off;
+        stats_.blocks_failed++;
+        stats_.blk_skipped.push_back(
+            {info.offset, info.size, std::string("parse error: ") + e.what()});
+
+        if (verbose_)
+            std::cerr << "[skip] blk offset=" << info.offset << " len=" << info.size
+                      << " parse error: " << e.what() << "\n";
+        return false;
+    }
+
+    stats_.blocks_written++;
+    return true;
+}
 
-        if (blk_off + 8 > blk_raw.size())
-            throw std::runtime_error("blk truncated");
+void BlockParser::print_progress() const
+{
+    std::cerr << "[progress] blocks=" << stats_.blocks_written
+              << " skipped=" << stats_.records_skipped
+              << " blk=" << stats_.blk_bytes_parsed << "/" << stats_.blk_file_bytes
+              << " rev=" << stats_.rev_bytes_parsed << "/" << stats_.rev_file_bytes
+              << "\n";
+}
 
-        uint32_t blk_magic = read_uint32_le(blk_raw, blk_off);
-        blk_off += 4;
+bool BlockParser::is_stream_path(const std::string &path)
+{
+    if (path == "-")
+        return true;
 
-        uint32_t blk_size = read_uint32_le(blk_raw, blk_off);
-        blk_off += 4;
+    std::error_code ec;
+    fs::file_status st = fs::status(path, ec);
+    return !ec && fs::exists(st) && !fs::is_regular_file(st);
+}
 
-        size_t blk_total = 8 + blk_size;
+// walk() for a blk input that cannot be mapped or seeked, or that is read
+// with the Direct backend. The rev file is held whole, so its records are
+// listed up front by undo tx count and each streamed block is checked
+// against the candidates with its tx count.
+size_t BlockParser::walk_stream(bool stop_at_first)
+{
+    std::unique_ptr<MappedFile> rev_file = open_input(rev_path_, rev_reader_);
+    stats_.rev_file_bytes = rev_file->size();
+    stats_.bytes_read = rev_file->size();
+
+    // undo tx count -> rev record offsets, in file order
+    std::unordered_map<uint64_t, std::vector<size_t>> rev_by_count;
+    std::vector<uint8_t> rev_scratch;
+    {
+        RecordScanner scanner = RecordScanner::for_rev(*rev_file, xor_key_);
+        DatRecord rec;
+        while (scanner.next(rec))
+        {
+            std::span<const uint8_t> head =
+                load_range(*rev_file, rec.offset, std::min<size_t>(rec.size, 8 + 9), xor_key_, rev_scratch);
+            size_t count_off = 8;
+            rev_by_count[read_varint(head, count_off)].push_back(rec.offset);
+        }
+        stats_.rev_skipped = scanner.skipped();
+    }
 
-        if (blk_start + blk_total > blk_raw.size())
-            throw std::runtime_error("blk record overflow");
+    bool direct = backend_ == ReadBackend::Direct && !is_stream_path(blk_path_);
+    DatRecordStream stream = DatRecordStream::for_blk(blk_path_, xor_key_, direct);
+    if (direct)
+        stats_.read_backend = stream.uses_o_direct() ? "direct" : "fadvise";
+    else
+        stats_.read_backend = "stream";
+    std::span<const uint8_t> blk_record;
+    size_t blk_offset = 0;
+    size_t last_rev = 0;
+
+    while (stream.next(blk_record, blk_offset))
+    {
+        stats_.records_read++;
+        stats_.blk_bytes_parsed = blk_offset + blk_record.size();
+        stats_.blk_file_bytes = stream.bytes_read();
+
+        BlkRecordInfo info;
+        info.offset = blk_offset;
+        info.size = blk_record.size();
+
+        // The stream enforces the minimum size, but don't rely on it for
+        // the header slice; a tx count running past the end only costs us
+        // that block
+        bool header_ok = blk_record.size() > 88;
+        if (header_ok)
+        {
+            try
+            {
+                size_t tx_off = 88;
+                info.tx_count = read_varint(blk_record, tx_off);
+            }
+            catch (const std::out_of_range &)
+            {
+                header_ok = false;
+            }
+        }
+        if (!header_ok)
+        {
+            stats_.blocks_failed++;
+            stats_.blk_skipped.push_back({info.offset, info.size, "truncated block header"});
+            if (verbose_)
+                std::cerr << "[skip] blk offset=" << info.offset << " len=" << info.size
+                          << " truncated block header\n";
+            continue;
+        }
 
-        std::vector<uint8_t> blk_record(
-            blk_raw.begin() + blk_start,
-            blk_raw.begin() + blk_start + blk_total
-        );
+        std::array<uint8_t, 80> hdr_bytes;
+        std::copy(blk_record.begin() + 8, blk_record.begin() + 88, hdr_bytes.begin());
+        BlockHeader hdr(hdr_bytes);
+        info.block_hash = hdr.getBlockHash();
+        info.prev_hash = hdr.getPreviousBlock();
+
+        // Undo records mostly follow block order, so start looking right
+        // after the last match
+        std::span<const uint8_t> rev_record;
+        auto found = rev_by_count.find(info.tx_count - 1);
+        if (info.tx_count > 0 && found != rev_by_count.end())
+        {
+            std::vector<size_t> &candidates = found->second;
+            size_t start = std::lower_bound(candidates.begin(), candidates.end(), last_rev) -
+                           candidates.begin();
+
+            for (size_t k = 0; k < candidates.size(); ++k)
+            {
+                size_t idx = (start + k) % candidates.size();
+                std::span<const uint8_t> rec =
+                    load_rev_record(*rev_file, candidates[idx], xor_key_, rev_scratch);
+                if (!UndoBlock::checksum_matches(rec, info.prev_hash))
+                    continue;
+
+                rev_record = rec;
+                last_rev = candidates[idx];
+                candidates.erase(candidates.begin() + static_cast<std::ptrdiff_t>(idx));
+                break;
+            }
+        }
 
-        blk_off = blk_start + blk_total;
+        if (rev_record.empty())
+        {
+            stats_.records_skipped++;
+            continue;
+        }
 
-        // ---------------- EXTRACT UNDO RECORD ----------------
-        size_t rev_start = rev_off;
+        stats_.rev_bytes_parsed += rev_record.size();
 
-        if (rev_off + 8 > rev_raw.size())
-            throw std::runtime_error("rev truncated");
+        if (!parse_pair(info, blk_record, rev_record))
+            continue;
 
-        uint32_t rev_magic = read_uint32_le(rev_raw, rev_off);
-        rev_off += 4;
+        if (stop_at_first)
+            break;
 
-        uint32_t rev_size = read_uint32_le(rev_raw, rev_off);
-        rev_off += 4;
+        if (verbose_)
+            print_progress();
+    }
 
-        size_t rev_total = 8 + rev_size + 32; // + checksum
+    for (const SkippedRange &r : stream.skipped())
+        stats_.blk_skipped.push_back(r);
+    stats_.blk_file_bytes = stream.bytes_read();
+    stats_.bytes_read += stream.bytes_read();
 
-        if (rev_start + rev_total > rev_raw.size())
-            throw std::runtime_error("rev record overflow");
+    for (const auto &entry : rev_by_count)
+        stats_.rev_records_unmatched += entry.second.size();
 
-        std::vector<uint8_t> rev_record(
-            rev_raw.begin() + rev_start,
-            rev_raw.begin() + rev_start + rev_total
-        );
+    record_cache_after();
 
-        rev_off = rev_start + rev_total;
+    if (stop_at_first && stats_.blocks_written == 0)
+        throw std::runtime_error("No matching block/undo pair found");
+
+    return stats_.blocks_written;
+}
+
+size_t BlockParser::walk(bool stop_at_first)
+{
+    stats_ = BlockParserStats{};
+
+    // Both reads are in flight once prefetch() returns; the blk headers are
+    // scanned while the rev file is still being read
+    prefetch();
+
+    // Direct streams the blk file record by record so memory stays bounded,
+    // only the (much smaller) rev file is read whole
+    if (is_stream_path(blk_path_) || backend_ == ReadBackend::Direct)
+        return walk_stream(stop_at_first);
+
+    std::unique_ptr<MappedFile> blk_file = open_input(blk_path_, blk_reader_);
+
+    // Blocks and undo records are not stored in the same order, so pair them
+    // up front: one header pass over blk, one checksum pass over rev
+    std::vector<BlkRecordInfo> blocks =
+        scan_blk_records(*blk_file, xor_key_, &stats_.blk_skipped);
+
+    std::unique_ptr<MappedFile> rev_file = open_input(rev_path_, rev_reader_);
+
+    stats_.blk_file_bytes = blk_file->size();
+    stats_.rev_file_bytes = rev_file->size();
+
+    RevOffsetIndex rev_index =
+        build_rev_index(*rev_file, xor_key_, blocks,
+                        &stats_.rev_records_unmatched, &stats_.rev_skipped);
+
+    if (verbose_)
+    {
+        for (const SkippedRange &r : stats_.blk_skipped)
+            std::cerr << "[skip] blk offset=" << r.offset << " len=" << r.length
+                      << " " << r.reason << "\n";
+        for (const SkippedRange &r : stats_.rev_skipped)
+            std::cerr << "[skip] rev offset=" << r.offset << " len=" << r.length
+                      << " " << r.reason << "\n";
+    }
+
+    // Reused across records, only touched for obfuscated files
+    std::vector<uint8_t> blk_scratch;
+    std::vector<uint8_t> rev_scratch;
+
+    for (const BlkRecordInfo &info : blocks)
+    {
+        stats_.records_read++;
+        stats_.blk_bytes_parsed = info.offset + info.size;
+
+        auto it = rev_index.find(bytes_to_hex(info.block_hash));
+        if (it == rev_index.end())
+        {
+            // No undo data in this rev file, e.g. a stale or not yet connected block
+            stats_.records_skipped++;
+            continue;
+        }
 
         // ---------------- PARSE ----------------
-        Block block(blk_record);
-        UndoBlock undo(rev_record);
+        blk_file->advise_willneed(info.offset, info.size);
+        std::span<const uint8_t> blk_record =
+            load_range(*blk_file, info.offset, info.size, xor_key_, blk_scratch);
+        std::span<const uint8_t> rev_record =
+            load_rev_record(*rev_file, it->second, xor_key_, rev_scratch);
+
+        stats_.rev_bytes_parsed += rev_record.size();
 
-        std::cerr << "blk tx=" << block.getTransactionCount()
-                  << " undo tx=" << undo.getTxCount() << "\n";
+        if (!parse_pair(info, blk_record, rev_record))
+            continue;
 
-        // ---------------- VALID ALIGNMENT ----------------
-        if (undo.getTxCount() == block.getTransactionCount() - 1)
+        if (stop_at_first)
         {
-            std::cerr << "✔ Found matching block/undo pair\n";
+            record_cache_after();
+            return stats_.blocks_written;
+        }
 
-            BlockAnalyzer analyzer(block, undo, "mainnet");
+        if (verbose_)
+            print_progress();
+    }
+
+    // An empty (fully preallocated) file is fine when walking everything
+    if (stop_at_first)
+        throw std::runtime_error("No matching block/undo pair found");
 
-            std::string out_path =
-                out_dir_ + "/" +
-                analyzer.block_header.block_hash + ".json";
+    record_cache_after();
+    return stats_.blocks_written;
+}
 
-            std::ofstream out(out_path);
-            if (!out)
-                throw std::runtime_error("Cannot open output");
+// ---------------- BlocksDirParser ----------------
 
-            out << block_to_json(analyzer).dump(4) << "\n";
+BlocksDirParser::BlocksDirParser(const std::string &blocks_dir,
+                                 const std::string &out_dir,
+                                 unsigned threads)
+    : blocks_dir_(blocks_dir),
+      out_dir_(out_dir),
+      threads_(threads)
+{
+    if (!fs::is_directory(blocks_dir_))
+        throw std::runtime_error("Not a directory: " + blocks_dir_);
 
-            return 1;
+    if (threads_ == 0)
+        threads_ = std::max(1u, std::thread::hardware_concurrency());
+
+    discover();
+    fs::create_directories(out_dir_);
+}
+
+void BlocksDirParser::set_read_backend(ReadBackend backend, unsigned queue_depth)
+{
+    backend_ = backend;
+    queue_depth_ = queue_depth;
+}
+
+// Collects every blkNNNNN.dat that has a matching revNNNNN.dat, in file order
+void BlocksDirParser::discover()
+{
+    for (const auto &entry : fs::directory_iterator(blocks_dir_))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        std::string name = entry.path().filename().string();
+        std::optional<unsigned> num = dat_file_number(name, "blk");
+        if (!num)
+            continue;
+
+        fs::path rev = entry.path().parent_path() / ("rev" + name.substr(3));
+        if (!fs::is_regular_file(rev))
+            continue;
+
+        BlockFileJob job;
+        job.file_number = *num;
+        job.blk_path = entry.path().string();
+        job.rev_path = rev.string();
+        jobs_.push_back(std::move(job));
+    }
+
+    std::sort(jobs_.begin(), jobs_.end(),
+              [](const BlockFileJob &a, const BlockFileJob &b)
+              { return a.file_number < b.file_number; });
+}
+
+size_t BlocksDirParser::run()
+{
+    std::string xor_str = blocks_dir_xor_path(blocks_dir_);
+
+    // Workers pull the next file pair from a shared counter; results land in
+    // the job's own slot so nothing depends on the order they finish in
+    std::atomic<size_t> next{0};
+
+    // Parser for job i with its reads already started (IoUring backend),
+    // nullptr if it could not even be set up
+    auto start = [&](size_t i) -> std::unique_ptr<BlockParser>
+    {
+        BlockFileJob &job = jobs_[i];
+        try
+        {
+            auto parser = std::make_unique<BlockParser>(job.blk_path, job.rev_path,
+                                                        xor_str, out_dir_);
+            parser->set_verbose(false);
+            parser->set_read_backend(backend_, queue_depth_);
+            parser->prefetch();
+            return parser;
+        }
+        catch (const std::exception &e)
+        {
+            job.error = e.what();
+            return nullptr;
         }
+    };
 
-        // Otherwise continue to next record
+    auto worker = [&]()
+    {
+        size_t i = next++;
+        std::unique_ptr<BlockParser> parser = i < jobs_.size() ? start(i) : nullptr;
+
+        // Passed from file to file, so every file after the first starts warm
+        std::unique_ptr<BlockWorkspace> workspace;
+
+        while (i < jobs_.size())
+        {
+            // Claim the next pair and get its I/O going before parsing this one
+            size_t j = next++;
+            std::unique_ptr<BlockParser> upcoming = j < jobs_.size() ? start(j) : nullptr;
+
+            BlockFileJob &job = jobs_[i];
+            if (parser)
+            {
+                parser->set_workspace(std::move(workspace));
+                try
+                {
+                    parser->run_all();
+                    job.stats = parser->stats();
+                }
+                catch (const std::exception &e)
+                {
+                    job.error = e.what();
+                }
+                workspace = parser->take_workspace();
+            }
+
+            i = j;
+            parser = std::move(upcoming);
+        }
+    };
+
+    size_t n_threads = std::min<size_t>(threads_, std::max<size_t>(jobs_.size(), 1));
+    std::vector<std::thread> pool;
+    pool.reserve(n_threads);
+    for (size_t t = 0; t < n_threads; ++t)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+
+    // Report in file order once everything is done
+    size_t blocks = 0;
+    size_t failed = 0;
+    for (const auto &job : jobs_)
+    {
+        std::cerr << "[file] " << fs::path(job.blk_path).filename().string();
+        if (job.error)
+        {
+            std::cerr << " error=" << *job.error << "\n";
+            failed++;
+            continue;
+        }
+        std::cerr << " blocks=" << job.stats.blocks_written
+                  << " skipped=" << job.stats.records_skipped
+                  << " failed=" << job.stats.blocks_failed
+                  << " skipped_ranges="
+                  << job.stats.blk_skipped.size() + job.stats.rev_skipped.size()
+                  << " allocs=" << job.stats.decode_allocations
+                  << " alloc_blocks=" << job.stats.blocks_allocating << "\n";
+        blocks += job.stats.blocks_written;
     }
 
-    throw std::runtime_error("No matching block/undo pair found");
-}
\ No newline at end of file
+    if (failed > 0)
+        throw std::runtime_error(std::to_string(failed) + " of " +
+                                 std::to_string(jobs_.size()) +
+                                 " blk/rev file pairs failed");
+
+    return blocks;
+}
@@ -4,22 +4,163 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <span>
 #include <cstdint>
+#include <optional>
+#include <array>
+#include <unordered_map>
+#include <memory>
+#include "mapped_file.h"
+#include "record_scanner.h"
+#include "async_reader.h"
+#include "direct_reader.h"
+#include "block_arena.h"
+#include "block.h"
 
+// Sequential, XOR decoding reader over a blk/rev file. path "-" reads
+// stdin, so non-seekable sources (pipes, decompressors) work too.
+// direct reads a regular file through DirectFileReader instead, keeping it
+// out of the page cache.
 class DatFileReader
 {
 public:
     DatFileReader(const std::string &path,
-                  const std::vector<uint8_t> &xor_key);
+                  const std::vector<uint8_t> &xor_key,
+                  bool direct = false);
+
+    // stream_ may point at our own file_
+    DatFileReader(const DatFileReader &) = delete;
+    DatFileReader &operator=(const DatFileReader &) = delete;
 
     bool read_bytes(std::vector<uint8_t> &buf, size_t n);
 
+    // Reads up to dst.size() bytes, fewer only at the end of the input.
+    // Returns the number of bytes read.
+    size_t read_some(std::span<uint8_t> dst);
+
+    uint64_t offset() const { return file_offset_; }
+
+    // Set if the reads bypass the page cache (direct and O_DIRECT worked)
+    bool uses_o_direct() const { return direct_ && direct_->uses_o_direct(); }
+
 private:
-    std::ifstream stream_;
+    std::ifstream file_;
+    std::istream *stream_;
+    std::unique_ptr<DirectFileReader> direct_;
     std::vector<uint8_t> xor_key_;
     uint64_t file_offset_ = 0;
 };
 
+// forward declarations, see block.h
+
+// Location and identity of one record in a blk file, from a header-only pass
+struct BlkRecordInfo
+{
+    size_t offset = 0; // start of the record (magic) in the file
+    size_t size = 0;   // 8 byte prefix + serialized block
+
+    std::array<uint8_t, 32> block_hash{}; // display order, see BlockHeader
+    std::array<uint8_t, 32> prev_hash{};  // as stored in the header
+    uint64_t tx_count = 0;
+
+    std::array<uint8_t, 80> header{}; // raw header, for a BlockHeader when needed
+};
+
+// block hash (hex, display order) -> offset of its undo record in a rev file
+using RevOffsetIndex = std::unordered_map<std::string, size_t>;
+
+// Reads the prefix, header and tx count of every record in a blk file,
+// skipping the transactions. Never throws on bad data, anything that is not
+// a record ends up in skipped (optional).
+std::vector<BlkRecordInfo> scan_blk_records(const MappedFile &blk_file,
+                                            const std::vector<uint8_t> &xor_key,
+                                            std::vector<SkippedRange> *skipped = nullptr);
+
+// Single pass over a rev file that pairs each undo record with its block by
+// verifying the record checksum against the block's prev hash.
+// unmatched (optional) receives the number of rev records with no block,
+// skipped (optional) the byte ranges that were not records.
+RevOffsetIndex build_rev_index(const MappedFile &rev_file,
+                               const std::vector<uint8_t> &xor_key,
+                               const std::vector<BlkRecordInfo> &blocks,
+                               size_t *unmatched = nullptr,
+                               std::vector<SkippedRange> *skipped = nullptr);
+
+// Where one block and its undo data live, see write_offset_index
+struct BlockOffsets
+{
+    size_t blk_offset = 0; // record start (magic) in the blk file
+    size_t rev_offset = 0; // record start (magic) in the rev file
+};
+
+// Offset sidecar for random access: one "<block hash> <blk offset> <rev offset>"
+// line per block that has undo data, block hash in display order (hex).
+// Returns the number of lines written.
+size_t write_offset_index(const std::string &index_path,
+                          const std::vector<BlkRecordInfo> &blocks,
+                          const RevOffsetIndex &rev_index);
+
+// Looks a block hash up in a sidecar written by write_offset_index
+std::optional<BlockOffsets> find_in_offset_index(const std::string &index_path,
+                                                 const std::string &block_hash);
+
+// Counters for one BlockParser run, updated as records are consumed
+struct BlockParserStats
+{
+    size_t records_read = 0;          // blk records visited
+    size_t records_skipped = 0;       // blk records with no undo record in the rev file
+    size_t blocks_written = 0;        // JSON reports written to out_dir
+    size_t rev_records_unmatched = 0; // rev records whose checksum matched no block
+    size_t blocks_failed = 0;         // blocks whose blk or rev record did not decode
+
+    // Byte ranges that held no usable record (padding, corruption, parse errors)
+    std::vector<SkippedRange> blk_skipped;
+    std::vector<SkippedRange> rev_skipped;
+
+    uint64_t blk_bytes_parsed = 0;
+    uint64_t blk_file_bytes = 0;
+    uint64_t rev_bytes_parsed = 0;
+    uint64_t rev_file_bytes = 0;
+
+    std::string read_backend = "mmap"; // "mmap", "io_uring"/"pread", "direct"/"fadvise", "stream"
+    uint64_t bytes_read = 0;           // blk + rev bytes brought into memory
+
+    // Bytes of the blk + rev files in the page cache before and after the run
+    uint64_t cache_resident_before = 0;
+    uint64_t cache_resident_after = 0;
+
+    // Heap allocations made while decoding and reporting blocks, and the
+    // blocks that made any. Both stop growing once the workspace is warm.
+    uint64_t decode_allocations = 0;
+    size_t blocks_allocating = 0;
+};
+
+// What decoding one block needs, reused from block to block: Block and
+// UndoBlock are reparsed in place and keep their capacity on heap, the
+// BlockAnalyzer's results go to arena, which is reset per block. Once the
+// biggest block so far has been seen a block allocates nothing. pubkeys
+// carries P2PK keys over to the next blocks that spend them.
+// One per thread, it moves between BlockParsers with set/take_workspace().
+struct BlockWorkspace
+{
+    CountingResource heap;
+    BlockArena arena;
+    Block block{&heap};
+    UndoBlock undo{&heap};
+    PubkeyCache pubkeys;
+
+    // Heap allocations over the workspace's life
+    size_t allocations() const { return heap.allocations + arena.heap_allocations(); }
+};
+
+// How BlockParser gets the blk/rev files into memory
+enum class ReadBackend
+{
+    Mmap,   // map the files and let the kernel fault pages in
+    IoUring, // read them up front with AsyncFileReader, several reads in flight
+    Direct   // read them with DirectFileReader, bypassing the page cache
+};
+
 class BlockParser
 {
 public:
@@ -28,13 +169,136 @@ public:
                 const std::string &xor_path,
                 const std::string &out_dir = "out");
 
+    // Writes the report of the first matching block/undo pair, returns 1
     size_t run();
 
+    // Walks every record of the blk/rev files in one pass and writes one
+    // report per block, returns the number of reports written
+    size_t run_all();
+
+    // Reads only the two records at the given offsets (pread, nothing else
+    // of either file is touched) and writes that block's report, returns 1.
+    // Throws if the undo record does not belong to the block.
+    size_t run_at(size_t blk_offset, size_t rev_offset);
+
+    // run_at() for a pair the caller already matched, e.g. by the undo
+    // checksum, which is then not verified again. txids: the block's
+    // display order txids if the caller hashed them, see Block::reparse.
+    size_t run_at_matched(size_t blk_offset, size_t rev_offset,
+                          std::span<const std::array<uint8_t, 32>> txids = {});
+
+    // run_at() for a block hash, offsets taken from an offset sidecar
+    size_t run_hash(const std::string &block_hash, const std::string &index_path);
+
+    // Writes the offset sidecar for these blk/rev files, returns its line count
+    size_t build_offset_index(const std::string &index_path);
+
+    const BlockParserStats &stats() const { return stats_; }
+
+    // Per record logging and progress lines on stderr, on by default
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+
+    // Mmap by default, queue_depth only matters for IoUring.
+    // Direct keeps a rescan of a live datadir out of the page cache.
+    void set_read_backend(ReadBackend backend,
+                          unsigned queue_depth = AsyncFileReader::DEFAULT_QUEUE_DEPTH);
+
+    // Threads used to decode the transactions of one block, 1 by default,
+    // 0 = one per hardware thread. Pays off for run() / run_at(), which
+    // decode a single block; run_all() and BlocksDirParser have plenty of
+    // blocks to keep the cores busy and should leave it at 1.
+    void set_decode_threads(unsigned threads) { decode_threads_ = threads; }
+
+    // Hands over a warm workspace from an earlier parser, one is created on
+    // first use otherwise. take_workspace() gives it back for the next one.
+    void set_workspace(std::unique_ptr<BlockWorkspace> workspace) { workspace_ = std::move(workspace); }
+    std::unique_ptr<BlockWorkspace> take_workspace() { return std::move(workspace_); }
+
+    // Starts reading both files in the background (IoUring backend only), so
+    // the I/O overlaps whatever the caller does until run()/run_all()
+    void prefetch();
+
+    // True if path can only be read front to back ("-" for stdin, a pipe),
+    // such blk inputs are streamed a record at a time
+    static bool is_stream_path(const std::string &path);
+
 private:
+    size_t walk(bool stop_at_first);
+    size_t walk_stream(bool stop_at_first);
+    bool parse_pair(const BlkRecordInfo &info,
+                    std::span<const uint8_t> blk_record,
+                    std::span<const uint8_t> rev_record);
+    void print_progress() const;
+    BlockWorkspace &workspace();
+    void decode_pair(std::span<const uint8_t> blk_record,
+                     std::span<const uint8_t> rev_record,
+                     bool verify_checksum,
+                     std::span<const std::array<uint8_t, 32>> txids = {});
+    size_t read_pair_at(size_t blk_offset, size_t rev_offset, bool verify_checksum,
+                        std::span<const std::array<uint8_t, 32>> txids);
+    void write_report(const Block &block, const UndoBlock &undo);
+    std::unique_ptr<MappedFile> open_input(const std::string &path,
+                                           std::unique_ptr<AsyncFileReader> &reader);
+    void record_cache_after();
+
     std::string blk_path_;
     std::string rev_path_;
     std::string out_dir_;
     std::vector<uint8_t> xor_key_;
+    BlockParserStats stats_;
+    bool verbose_ = true;
+
+    ReadBackend backend_ = ReadBackend::Mmap;
+    unsigned queue_depth_ = AsyncFileReader::DEFAULT_QUEUE_DEPTH;
+    std::unique_ptr<AsyncFileReader> blk_reader_;
+    std::unique_ptr<AsyncFileReader> rev_reader_;
+    std::optional<uint64_t> cache_before_;
+    unsigned decode_threads_ = 1;
+
+    std::unique_ptr<BlockWorkspace> workspace_;
+};
+
+// One blkNNNNN.dat/revNNNNN.dat pair of a blocks directory
+struct BlockFileJob
+{
+    unsigned file_number = 0;
+    std::string blk_path;
+    std::string rev_path;
+
+    BlockParserStats stats;
+    std::optional<std::string> error;
+};
+
+// Runs BlockParser::run_all() over every file pair in a bitcoind blocks
+// directory on a pool of worker threads, one file pair per task
+class BlocksDirParser
+{
+public:
+    // threads == 0 means one worker per hardware thread
+    BlocksDirParser(const std::string &blocks_dir,
+                    const std::string &out_dir = "out",
+                    unsigned threads = 0);
+
+    // With IoUring each worker starts reading its next file pair before it
+    // parses the current one
+    void set_read_backend(ReadBackend backend,
+                          unsigned queue_depth = AsyncFileReader::DEFAULT_QUEUE_DEPTH);
+
+    // Returns the total number of block reports written
+    size_t run();
+
+    const std::vector<BlockFileJob> &jobs() const { return jobs_; }
+
+private:
+    void discover();
+
+    std::string blocks_dir_;
+    std::string out_dir_;
+    unsigned threads_;
+    std::vector<BlockFileJob> jobs_;
+
+    ReadBackend backend_ = ReadBackend::Mmap;
+    unsigned queue_depth_ = AsyncFileReader::DEFAULT_QUEUE_DEPTH;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef BYTE_READER_H
+#define BYTE_READER_H
+
+#include <span>
+#include <array>
+#include <bit>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+// Little endian loads from unaligned memory, one memcpy each
+inline uint16_t load_le16(const uint8_t *p)
+{
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big)
+        v = __builtin_bswap16(v);
+    return v;
+}
+
+inline uint32_t load_le32(const uint8_t *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big)
+        v = __builtin_bswap32(v);
+    return v;
+}
+
+inline uint64_t load_le64(const uint8_t *p)
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big)
+        v = __builtin_bswap64(v);
+    return v;
+}
+
+// Bounds policies for ByteReader
+
+// Every read makes sure it stays inside the data, and throws
+// std::runtime_error("<context>: truncated <what>") if not
+struct CheckedBounds
+{
+    static constexpr bool checked = true;
+};
+
+// No checks at all. Only for bytes whose layout a checked pass has already
+// walked, e.g. a transaction after scan_transaction()
+struct UncheckedBounds
+{
+    static constexpr bool checked = false;
+};
+
+// Sequential reader over a byte span. Which policy to use is decided at
+// compile time, so the same parsing code serves validated and untrusted
+// input, and the unchecked instantiation is just the loads.
+template <typename Bounds>
+class ByteReader
+{
+public:
+    // context prefixes error messages, e.g. "Transaction"
+    explicit ByteReader(std::span<const uint8_t> data, size_t offset = 0,
+                        const char *context = "ByteReader")
+        : data_(data), off_(offset), context_(context)
+    {
+    }
+
+    size_t offset() const { return off_; }
+    size_t remaining() const { return data_.size() - off_; }
+    std::span<const uint8_t> data() const { return data_; }
+
+    uint8_t u8(const char *what = "byte")
+    {
+        need(1, what);
+        return data_[off_++];
+    }
+
+    uint16_t u16(const char *what = "uint16")
+    {
+        need(2, what);
+        uint16_t v = load_le16(data_.data() + off_);
+        off_ += 2;
+        return v;
+    }
+
+    uint32_t u32(const char *what = "uint32")
+    {
+        need(4, what);
+        uint32_t v = load_le32(data_.data() + off_);
+        off_ += 4;
+        return v;
+    }
+
+    uint64_t u64(const char *what = "uint64")
+    {
+        need(8, what);
+        uint64_t v = load_le64(data_.data() + off_);
+        off_ += 8;
+        return v;
+    }
+
+    // CompactSize, see read_varint
+    uint64_t varint(const char *what = "varint")
+    {
+        uint8_t prefix = u8(what);
+        if (prefix < 0xFD)
+            return prefix;
+        if (prefix == 0xFD)
+            return u16(what);
+        if (prefix == 0xFE)
+            return u32(what);
+        return u64(what);
+    }
+
+    // Bitcoin Core's VARINT (serialize.h), used by undo data. 7 bits per
+    // byte, high bit = more bytes follow, +1 on each continuation.
+    uint64_t cvarint(const char *what = "varint")
+    {
+        uint64_t n = 0;
+        while (true)
+        {
+            uint8_t b = u8(what);
+            n = (n << 7) | (b & 0x7F);
+            if (!(b & 0x80))
+                return n;
+            n += 1;
+        }
+    }
+
+    // View of the next n bytes
+    std::span<const uint8_t> bytes(uint64_t n, const char *what = "bytes")
+    {
+        need(n, what);
+        std::span<const uint8_t> out = data_.subspan(off_, static_cast<size_t>(n));
+        off_ += static_cast<size_t>(n);
+        return out;
+    }
+
+    template <size_t N>
+    std::array<uint8_t, N> array(const char *what = "bytes")
+    {
+        need(N, what);
+        std::array<uint8_t, N> out;
+        std::memcpy(out.data(), data_.data() + off_, N);
+        off_ += N;
+        return out;
+    }
+
+    void skip(uint64_t n, const char *what = "bytes")
+    {
+        need(n, what);
+        off_ += static_cast<size_t>(n);
+    }
+
+    // True if the next bytes are b0 b1 (no bounds error if there are fewer)
+    bool peek_equals(uint8_t b0, uint8_t b1) const
+    {
+        return remaining() >= 2 && data_[off_] == b0 && data_[off_ + 1] == b1;
+    }
+
+private:
+    void need(uint64_t n, const char *what) const
+    {
+        if constexpr (Bounds::checked)
+        {
+            if (n > remaining())
+                throw std::runtime_error(std::string(context_) + ": truncated " + what);
+        }
+    }
+
+    std::span<const uint8_t> data_;
+    size_t off_;
+    const char *context_;
+};
+
+#endif
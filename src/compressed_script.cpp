@@ -0,0 +1,134 @@
+#include "compressed_script.h"
+#include "utilities.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+uint64_t compressed_script_size(uint64_t type)
+{
+    if (type <= 1)
+        return 20; // hash160
+    if (type <= 5)
+        return 32; // x coordinate
+    return type - 6; // raw script
+}
+
+void CompressedScript::assign(uint64_t type, std::span<const uint8_t> payload)
+{
+    type_ = type;
+    payload_.assign(payload);
+    has_pubkey_y_ = false;
+}
+
+void CompressedScript::assign_raw(std::span<const uint8_t> script)
+{
+    assign(script.size() + 6, script);
+}
+
+OutputScriptType CompressedScript::output_type() const
+{
+    switch (type_)
+    {
+    case 0:
+        return OutputScriptType::P2PKH;
+    case 1:
+        return OutputScriptType::P2SH;
+    case 2:
+    case 3:
+    case 4:
+    case 5:
+        return OutputScriptType::UNKNOWN; // P2PK has no type of its own
+    default:
+        return classify_output_script(payload_);
+    }
+}
+
+// Rebuilds the scriptPubKey the way Bitcoin Core's DecompressScript does
+void CompressedScript::decompress(Script &script) const
+{
+    script.clear();
+    switch (type_)
+    {
+    case 0:
+    { // P2PKH
+        script.append(std::array<uint8_t, 3>{0x76, 0xa9, 0x14});
+        script.append(payload_);
+        script.push_back(0x88);
+        script.push_back(0xac);
+        break;
+    }
+    case 1:
+    { // P2SH
+        script.append(std::array<uint8_t, 2>{0xa9, 0x14});
+        script.append(payload_);
+        script.push_back(0x87);
+        break;
+    }
+    case 2:
+    case 3:
+    { // P2PK compressed
+        script.append(std::array<uint8_t, 2>{0x21, static_cast<uint8_t>(type_)});
+        script.append(payload_);
+        script.push_back(0xac);
+        break;
+    }
+    case 4:
+    case 5:
+    {
+        std::array<uint8_t, 32> y = has_pubkey_y_ ? pubkey_y_
+                                                  : decompress_pubkey_y(payload().first<32>(), type_ == 5);
+
+        // Build script:
+        // OP_PUSH65 04 <32-byte x> <32-byte y> OP_CHECKSIG
+        script.reserve(67);
+        script.push_back(0x41); // push 65 bytes
+        script.push_back(0x04); // uncompressed
+        script.append(payload_);
+        script.append(y);
+        script.push_back(0xac); // OP_CHECKSIG
+        break;
+    }
+    default:
+        script.assign(payload_);
+        break;
+    }
+}
+
+std::array<uint8_t, 32> decompress_pubkey_y(std::span<const uint8_t, 32> x, bool odd)
+{
+    // Reconstruct compressed pubkey (33 bytes)
+    unsigned char compressed[33];
+    compressed[0] = odd ? 0x03 : 0x02;
+    std::memcpy(compressed + 1, x.data(), 32);
+
+    // Parse using secp256k1
+    secp256k1_pubkey pubkey;
+
+    if (!secp256k1_ec_pubkey_parse(
+            Secp256k1Context::instance(),
+            &pubkey,
+            compressed,
+            33))
+    {
+        throw std::runtime_error("Invalid compressed pubkey in undo data");
+    }
+
+    // Serialize as uncompressed (65 bytes): 04 || x || y
+    unsigned char full[65];
+    size_t full_len = 65;
+
+    secp256k1_ec_pubkey_serialize(
+        Secp256k1Context::instance(),
+        full,
+        &full_len,
+        &pubkey,
+        SECP256K1_EC_UNCOMPRESSED);
+
+    if (full_len != 65)
+        throw std::runtime_error("Unexpected pubkey length");
+
+    std::array<uint8_t, 32> y;
+    std::memcpy(y.data(), full + 33, 32);
+    return y;
+}
@@ -0,0 +1,83 @@
+#ifndef COMPRESSED_SCRIPT_H
+#define COMPRESSED_SCRIPT_H
+
+#include "small_script.h"
+#include "script.h"
+#include <array>
+#include <memory_resource>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// A scriptPubKey in Bitcoin Core's compressed form (compressor.cpp), the way
+// undo data stores spent coins: a type tag and its payload.
+//   0     P2PKH, payload is the hash160
+//   1     P2SH, payload is the hash160
+//   2, 3  P2PK with a compressed key, payload is x, the tag its prefix
+//   4, 5  P2PK with an uncompressed key, payload is x, tag - 2 the y parity
+//   >= 6  any other script, payload is the script (type - 6 bytes)
+// Types and addresses come straight from the tag and hash, the full script
+// is only rebuilt by decompress(). For types 4/5 that needs the pubkey's y
+// coordinate: set_pubkey_y() hands in one computed ahead of time (see
+// UndoBlock::decompress_pubkeys), otherwise decompress() calls secp256k1.
+class CompressedScript
+{
+public:
+    explicit CompressedScript(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+        : payload_(mr)
+    {
+    }
+
+    CompressedScript(uint64_t type, std::span<const uint8_t> payload,
+                     std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+        : type_(type), payload_(payload, mr)
+    {
+    }
+
+    uint64_t type() const { return type_; }
+    std::span<const uint8_t> payload() const { return payload_; }
+
+    // Both clear the pubkey y
+    void assign(uint64_t type, std::span<const uint8_t> payload);
+
+    // Stores script as is (a raw type), for prevouts that come as full scripts
+    void assign_raw(std::span<const uint8_t> script);
+
+    // True for types 0 to 5
+    bool is_special() const { return type_ < 6; }
+
+    // Same result as classify_output_script() on the full script
+    OutputScriptType output_type() const;
+
+    // True for types 4 and 5, whose full script needs the y coordinate
+    bool needs_pubkey_y() const { return type_ == 4 || type_ == 5; }
+
+    // y of a type 4/5 pubkey, computed elsewhere. Kept by value, so copies
+    // of the script carry it along and stay valid after the undo block that
+    // computed it is reparsed.
+    void set_pubkey_y(const std::array<uint8_t, 32> &y)
+    {
+        pubkey_y_ = y;
+        has_pubkey_y_ = true;
+    }
+
+    // Writes the full scriptPubKey to out, replacing its contents. Throws
+    // for a type 4/5 x coordinate that is not on the curve.
+    void decompress(Script &out) const;
+
+private:
+    uint64_t type_ = 6; // empty raw script
+    Script payload_;
+    std::array<uint8_t, 32> pubkey_y_{};
+    bool has_pubkey_y_ = false;
+};
+
+// Payload bytes that follow a compressed script's type
+uint64_t compressed_script_size(uint64_t type);
+
+// y coordinate of the secp256k1 point with this x and y parity, the costly
+// part of decompressing a type 4/5 script (a modular square root). Throws
+// if x is not on the curve.
+std::array<uint8_t, 32> decompress_pubkey_y(std::span<const uint8_t, 32> x, bool odd);
+
+#endif
@@ -0,0 +1,154 @@
+#include "direct_reader.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// O_DIRECT wants buffer address, file offset and length aligned to the
+// logical block size; 4 KiB covers every common device
+static constexpr size_t DIRECT_ALIGN = 4096;
+
+DirectFileReader::DirectFileReader(const std::string &path, size_t chunk_size)
+    : path_(path),
+      chunk_size_(std::max(DIRECT_ALIGN, chunk_size - chunk_size % DIRECT_ALIGN))
+{
+#ifdef O_DIRECT
+    fd_ = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    direct_ = fd_ >= 0;
+#endif
+
+    // tmpfs and some network filesystems reject O_DIRECT
+    if (fd_ < 0)
+        fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+        throw std::runtime_error("DirectFileReader: cannot open: " + path);
+}
+
+DirectFileReader::~DirectFileReader()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool DirectFileReader::refill()
+{
+    if (!bounce_)
+    {
+        bounce_.reset(static_cast<uint8_t *>(std::aligned_alloc(DIRECT_ALIGN, chunk_size_)));
+        if (!bounce_)
+            throw std::runtime_error("DirectFileReader: out of memory");
+    }
+
+    while (!eof_)
+    {
+        // Always ask for whole chunks, O_DIRECT just returns less at EOF
+        ssize_t n = ::pread(fd_, bounce_.get(), chunk_size_, static_cast<off_t>(offset_));
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n < 0 && errno == EINVAL && direct_)
+        {
+            // Opened fine but the device will not do direct reads after all
+            int fd = ::open(path_.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("DirectFileReader: cannot open: " + path_);
+            ::close(fd_);
+            fd_ = fd;
+            direct_ = false;
+            continue;
+        }
+
+        if (n < 0)
+            throw std::runtime_error("DirectFileReader: read error: " + path_);
+
+        size_t got = static_cast<size_t>(n);
+        if (got == 0)
+        {
+            eof_ = true;
+            break;
+        }
+
+        if (!direct_)
+            ::posix_fadvise(fd_, static_cast<off_t>(offset_), static_cast<off_t>(got),
+                            POSIX_FADV_DONTNEED);
+
+        pos_ = 0;
+        len_ = got;
+        offset_ += got;
+        bytes_read_ += got;
+        return true;
+    }
+
+    return false;
+}
+
+size_t DirectFileReader::read_some(std::span<uint8_t> dst)
+{
+    size_t done = 0;
+    while (done < dst.size())
+    {
+        if (pos_ == len_ && !refill())
+            break;
+
+        size_t n = std::min(dst.size() - done, len_ - pos_);
+        std::memcpy(dst.data() + done, bounce_.get() + pos_, n);
+        pos_ += n;
+        done += n;
+    }
+    return done;
+}
+
+FileBuffer DirectFileReader::read_all()
+{
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+        throw std::runtime_error("DirectFileReader: cannot stat: " + path_);
+
+    size_t size = static_cast<size_t>(st.st_size);
+    FileBuffer out(size > offset_ ? size - offset_ + (len_ - pos_) : len_ - pos_);
+
+    size_t got = read_some(std::span<uint8_t>(out));
+    out.resize(got);
+    return out;
+}
+
+uint64_t page_cache_resident_bytes(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return 0;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void *p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return 0;
+
+    static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> vec((size + page - 1) / page);
+
+    uint64_t resident = 0;
+    if (::mincore(p, size, vec.data()) == 0)
+    {
+        for (size_t i = 0; i < vec.size(); ++i)
+            if (vec[i] & 1)
+                resident += std::min(page, size - i * page);
+    }
+
+    ::munmap(p, size);
+    return resident;
+}
@@ -0,0 +1,65 @@
+#ifndef DIRECT_READER_H
+#define DIRECT_READER_H
+
+#include "mapped_file.h"
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+// Reads a file front to back without leaving it in the page cache, so
+// scanning a live datadir does not evict the node's own hot pages
+// (chainstate, recent blocks). Uses O_DIRECT through an aligned bounce
+// buffer; where the filesystem refuses O_DIRECT it reads normally and drops
+// each chunk with posix_fadvise(DONTNEED) right behind the cursor.
+class DirectFileReader
+{
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 8 * 1024 * 1024;
+
+    explicit DirectFileReader(const std::string &path,
+                              size_t chunk_size = DEFAULT_CHUNK_SIZE);
+    ~DirectFileReader();
+
+    DirectFileReader(const DirectFileReader &) = delete;
+    DirectFileReader &operator=(const DirectFileReader &) = delete;
+
+    // Next bytes of the file, up to dst.size(), fewer only at the end. Memory
+    // stays at one chunk however big the file is. Throws on read errors.
+    size_t read_some(std::span<uint8_t> dst);
+
+    // Whole file contents from the current position, throws on read errors.
+    // Holds the entire file in memory, read_some() is the bounded way.
+    FileBuffer read_all();
+
+    // False if the file had to be read buffered (+ DONTNEED)
+    bool uses_o_direct() const { return direct_; }
+    uint64_t bytes_read() const { return bytes_read_; }
+
+private:
+    // Reads the chunk at offset_ into the bounce buffer, false at the end
+    bool refill();
+
+    std::string path_;
+    int fd_ = -1;
+    bool direct_ = false;
+    size_t chunk_size_;
+    uint64_t bytes_read_ = 0;
+
+    // Bounce buffer, [pos_, len_) of it not handed out yet; it holds the
+    // chunk that starts at offset_ - len_
+    std::unique_ptr<uint8_t, decltype(&std::free)> bounce_{nullptr, &std::free};
+    size_t pos_ = 0;
+    size_t len_ = 0;
+    uint64_t offset_ = 0; // file position of the next chunk
+    bool eof_ = false;
+};
+
+// Bytes of the file currently in the page cache (mincore over a mapping that
+// is never touched), 0 if it cannot be determined
+uint64_t page_cache_resident_bytes(const std::string &path);
+
+#endif
@@ -0,0 +1,172 @@
+#include "header_scan.h"
+#include "utilities.h"
+#include "mapped_file.h"
+
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <optional>
+#include <unordered_map>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+// Keys are display order block hashes: their leading bytes are the proof
+// of work zeros, shared by nearly every block, so hash the last 8 bytes
+struct Hash32
+{
+    size_t operator()(const std::array<uint8_t, 32> &h) const
+    {
+        size_t v;
+        std::memcpy(&v, h.data() + 24, sizeof(v));
+        return v;
+    }
+};
+
+HeaderScanner::HeaderScanner(const std::string &path, unsigned threads)
+    : threads_(threads)
+{
+    fs::path dir;
+
+    if (fs::is_directory(path))
+    {
+        dir = path;
+        for (const auto &entry : fs::directory_iterator(dir))
+        {
+            if (!entry.is_regular_file())
+                continue;
+            if (auto num = dat_file_number(entry.path().filename().string(), "blk"))
+                files_.emplace_back(*num, entry.path().string());
+        }
+        std::sort(files_.begin(), files_.end());
+    }
+    else if (fs::is_regular_file(path))
+    {
+        dir = fs::path(path).parent_path();
+        files_.emplace_back(dat_file_number(fs::path(path).filename().string(), "blk").value_or(0), path);
+    }
+    else
+    {
+        throw std::runtime_error("No such file or directory: " + path);
+    }
+
+    xor_key_ = read_blocks_dir_xor_key(dir.string());
+
+    if (threads_ == 0)
+        threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+size_t HeaderScanner::run()
+{
+    std::vector<std::vector<BlkRecordInfo>> per_file(files_.size());
+    std::vector<size_t> skipped(files_.size(), 0);
+    std::vector<std::string> errors(files_.size());
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < files_.size(); i = next++)
+        {
+            try
+            {
+                MappedFile blk_file(files_[i].second);
+                blk_file.advise_random();
+
+                std::vector<SkippedRange> ranges;
+                per_file[i] = scan_blk_records(blk_file, xor_key_, &ranges);
+                skipped[i] = ranges.size();
+            }
+            catch (const std::exception &e)
+            {
+                errors[i] = e.what();
+            }
+        }
+    };
+
+    size_t n_threads = std::min<size_t>(threads_, std::max<size_t>(files_.size(), 1));
+    std::vector<std::thread> pool;
+    pool.reserve(n_threads);
+    for (size_t t = 0; t < n_threads; ++t)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+
+    for (size_t i = 0; i < files_.size(); ++i)
+        if (!errors[i].empty())
+            throw std::runtime_error(files_[i].second + ": " + errors[i]);
+
+    records_.clear();
+    skipped_ranges_ = 0;
+    for (size_t i = 0; i < files_.size(); ++i)
+    {
+        for (const BlkRecordInfo &info : per_file[i])
+            records_.push_back({files_[i].first, info, -1});
+        skipped_ranges_ += skipped[i];
+    }
+
+    assign_heights();
+    return records_.size();
+}
+
+void HeaderScanner::assign_heights()
+{
+    // block hash (display order) -> index in records_
+    std::unordered_map<std::array<uint8_t, 32>, size_t, Hash32> by_hash;
+    by_hash.reserve(records_.size());
+    for (size_t i = 0; i < records_.size(); ++i)
+        by_hash.emplace(records_[i].info.block_hash, i);
+
+    // -1 = not visited yet, UNCONNECTED = known not to reach genesis
+    const int64_t UNCONNECTED = -2;
+    static const std::array<uint8_t, 32> null_hash{};
+    std::vector<size_t> chain;
+
+    for (size_t i = 0; i < records_.size(); ++i)
+    {
+        // Walk back until a visited block (or genesis), then number everything
+        // on the way; iterative, chains are ~1M long
+        chain.clear();
+        size_t cur = i;
+        bool connected = true;
+
+        while (records_[cur].height == -1)
+        {
+            chain.push_back(cur);
+
+            const std::array<uint8_t, 32> &prev = records_[cur].info.prev_hash;
+            if (prev == null_hash)
+                break;
+
+            auto it = by_hash.find(reverse_32(prev));
+            if (it == by_hash.end())
+            {
+                connected = false; // parent not in these files, e.g. pruned
+                break;
+            }
+            cur = it->second;
+        }
+
+        if (records_[cur].height == UNCONNECTED)
+            connected = false;
+
+        // Genesis ends the walk on itself, otherwise cur is the known parent
+        int64_t height = records_[cur].height >= 0 ? records_[cur].height : -1;
+
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            records_[*it].height = connected ? ++height : UNCONNECTED;
+    }
+
+    for (HeaderRecord &r : records_)
+        if (r.height == UNCONNECTED)
+            r.height = -1;
+}
+
+const HeaderRecord *HeaderScanner::tip() const
+{
+    const HeaderRecord *best = nullptr;
+    for (const HeaderRecord &r : records_)
+        if (r.height >= 0 && (!best || r.height > best->height))
+            best = &r;
+    return best;
+}
@@ -0,0 +1,53 @@
+#ifndef HEADER_SCAN_H
+#define HEADER_SCAN_H
+
+#include "block_parser.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// One block header found by HeaderScanner
+struct HeaderRecord
+{
+    unsigned file_number = 0; // NNNNN of blkNNNNN.dat
+    BlkRecordInfo info;
+    int64_t height = -1;      // -1 if the block does not connect to genesis
+};
+
+// Header chain of a whole blocks directory without parsing a transaction:
+// per record only the prefix, the 80 byte header and the tx count are read
+// (scan_blk_records over a MADV_RANDOM mapping, so the kernel does not read
+// ahead into the transactions). Files are scanned on a pool of threads,
+// heights are assigned by following prev hashes back to genesis.
+class HeaderScanner
+{
+public:
+    // path is a blocks directory or a single blk file; threads == 0 means one
+    // worker per hardware thread
+    explicit HeaderScanner(const std::string &path, unsigned threads = 0);
+
+    // Scans every blk file, returns the number of headers found
+    size_t run();
+
+    // In file order, then record order within a file
+    const std::vector<HeaderRecord> &records() const { return records_; }
+
+    // Highest block connected to genesis, nullptr if there is none
+    const HeaderRecord *tip() const;
+
+    // Byte ranges of all files that held no record
+    size_t skipped_ranges() const { return skipped_ranges_; }
+
+private:
+    void assign_heights();
+
+    std::vector<std::pair<unsigned, std::string>> files_; // (number, path)
+    unsigned threads_;
+    std::vector<uint8_t> xor_key_;
+    std::vector<HeaderRecord> records_;
+    size_t skipped_ranges_ = 0;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "json_helper.h"
+#include "byte_reader.h"
 
 nlohmann::ordered_json analyzed_txn_to_json(const TxnAnalyzer &ta)
 {
@@ -153,8 +154,9 @@ InputTxnWithPrevout json_to_input_txn_with_prevout(const nlohmann::json &j)
 
         prev.vout = p.at("vout").get<uint32_t>();
         prev.value_sats = p.at("value_sats").get<uint64_t>();
-        prev.script_pubkey_hex =
+        std::vector<uint8_t> script =
             hex_to_bytes(p.at("script_pubkey_hex").get<std::string>());
+        prev.script_pubkey.assign_raw(script);
 
         result.prevouts.push_back(prev);
     }
@@ -222,3 +224,84 @@ nlohmann::ordered_json block_to_json(const BlockAnalyzer &ba)
         {"transactions", transactions},
         {"block_stats", block_stats}};
 }
+
+// bits as big-endian hex, as in the block report
+static std::string bits_to_hex(uint32_t bits_val)
+{
+    std::vector<uint8_t> bits_bytes = {
+        uint8_t(bits_val >> 24),
+        uint8_t(bits_val >> 16),
+        uint8_t(bits_val >> 8),
+        uint8_t(bits_val)};
+    return bytes_to_hex(bits_bytes);
+}
+
+// Fields are read straight from the raw header and the hash comes from the
+// scan, building a BlockHeader would hash every header a second time
+nlohmann::ordered_json header_record_to_json(const HeaderRecord &rec)
+{
+    ByteReader<UncheckedBounds> r(rec.info.header);
+    int32_t version = static_cast<int32_t>(r.u32());
+    std::array<uint8_t, 32> prev_block = r.array<32>();
+    std::array<uint8_t, 32> merkle_root = r.array<32>();
+    int32_t timestamp = static_cast<int32_t>(r.u32());
+    uint32_t bits_val = r.u32();
+    int32_t nonce = static_cast<int32_t>(r.u32());
+
+    json height = rec.height >= 0 ? json(rec.height) : json(nullptr);
+
+    return {
+        {"block_hash", bytes_to_hex(rec.info.block_hash)},
+        {"height", height},
+        {"version", version},
+        {"prev_block_hash", bytes_to_hex(reverse_32(prev_block))},
+        {"merkle_root", bytes_to_hex(reverse_32(merkle_root))},
+        {"timestamp", timestamp},
+        {"bits", bits_to_hex(bits_val)},
+        {"nonce", nonce},
+        {"tx_count", rec.info.tx_count},
+        {"file", rec.file_number},
+        {"offset", rec.info.offset}};
+}
+
+nlohmann::ordered_json block_summary_to_json(LazyBlock &block,
+                                             const std::optional<std::array<uint8_t, 32>> &find_txid)
+{
+    const BlockHeader &hdr = block.getHeader();
+    json block_header = {
+        {"version", hdr.getVersion()},
+        {"prev_block_hash", bytes_to_hex(reverse_32(hdr.getPreviousBlock()))},
+        {"merkle_root", bytes_to_hex(reverse_32(hdr.getMerkleRoot()))},
+        {"timestamp", hdr.getTimestamp()},
+        {"bits", bits_to_hex(static_cast<uint32_t>(hdr.getBits()))},
+        {"nonce", hdr.getNonce()},
+        {"block_hash", hdr.getHashStr()}};
+
+    const TransactionView &cb = block.coinbase();
+    uint64_t cb_output_sats = 0;
+    for (const auto &out : cb.outputs)
+        cb_output_sats += out.amount;
+
+    json coinbase = {
+        {"txid", bytes_to_hex(cb.get_txid())},
+        {"bip34_height", block.bip34_height()},
+        {"coinbase_script_hex", bytes_to_hex(cb.inputs[0].scriptSig)},
+        {"total_output_sats", cb_output_sats}};
+
+    json summary = {
+        {"ok", true},
+        {"mode", "block_summary"},
+        {"block_header", block_header},
+        {"tx_count", block.getTransactionCount()},
+        {"coinbase", coinbase}};
+
+    if (find_txid)
+    {
+        std::optional<size_t> index = block.find_txid(*find_txid);
+        summary["txid"] = bytes_to_hex(*find_txid);
+        summary["txid_index"] = index ? json(*index) : json(nullptr);
+    }
+
+    summary["decoded_transactions"] = block.materialized_count();
+    return summary;
+}
@@ -1,4 +1,6 @@
 #include "accounting.h"
+#include "header_scan.h"
+#include "lazy_block.h"
 #include <nlohmann/json.hpp>
 #include <fstream>
 
@@ -14,3 +16,12 @@ InputTxnWithPrevout json_to_input_txn_with_prevout(const nlohmann::json &j);
 nlohmann::json get_json(std::string filepath);
 
 nlohmann::ordered_json block_to_json(const BlockAnalyzer &ba);
+
+// One line of --headers-only output: header fields + where the block lives
+nlohmann::ordered_json header_record_to_json(const HeaderRecord &rec);
+
+// --block-summary output: header, tx count and coinbase, plus the index of
+// find_txid if given. Only the coinbase (and whatever the txid lookup needs
+// hashed) is touched, the other transactions are never decoded.
+nlohmann::ordered_json block_summary_to_json(LazyBlock &block,
+                                             const std::optional<std::array<uint8_t, 32>> &find_txid);
@@ -0,0 +1,111 @@
+#include "lazy_block.h"
+#include "byte_reader.h"
+
+#include <stdexcept>
+
+LazyBlock::LazyBlock(std::span<const uint8_t> blk_record, std::pmr::memory_resource *mr)
+    : record(blk_record), mr(mr), offsets(mr), txs(mr)
+{
+    if (record.size() < 8)
+        throw std::runtime_error("Block: buffer too short");
+
+    ByteReader<CheckedBounds> r(record, 0, "Block");
+
+    magic = r.u32("magic");
+    blockSize = r.u32("size");
+
+    std::array<uint8_t, 80> hdr_bytes = r.array<80>("block header");
+    blockHeader = BlockHeader(hdr_bytes);
+
+    txnCounter = r.varint("tx count");
+    scanOffset = r.offset();
+
+    // The slot table is sized up front, so make sure the count is possible
+    if (txnCounter > r.remaining() / MIN_TX_SIZE)
+        throw std::runtime_error("Block: tx count exceeds record size");
+
+    txs.assign(txnCounter, nullptr);
+}
+
+LazyBlock::~LazyBlock()
+{
+    std::pmr::polymorphic_allocator<TransactionView> alloc(mr);
+    for (TransactionView *tx : txs)
+        if (tx)
+            alloc.delete_object(tx);
+}
+
+const TxByteRanges &LazyBlock::ranges(size_t i)
+{
+    if (i >= txnCounter)
+        throw std::out_of_range("LazyBlock: no transaction " + std::to_string(i));
+
+    while (offsets.size() <= i)
+    {
+        offsets.push_back(scan_transaction(record, scanOffset));
+        scanOffset = offsets.back().end;
+    }
+
+    return offsets[i];
+}
+
+const TransactionView &LazyBlock::transaction(size_t i)
+{
+    const TxByteRanges &r = ranges(i);
+
+    if (!txs[i])
+    {
+        std::pmr::polymorphic_allocator<TransactionView> alloc(mr);
+        TransactionView *tx = alloc.new_object<TransactionView>(mr);
+        tx->parse(record, r);
+        txs[i] = tx;
+        materialized++;
+    }
+
+    return *txs[i];
+}
+
+std::array<uint8_t, 32> LazyBlock::txid(size_t i)
+{
+    const TxByteRanges &r = ranges(i);
+    return txs[i] ? txs[i]->get_txid() : r.txid(record);
+}
+
+std::optional<size_t> LazyBlock::find_txid(const std::array<uint8_t, 32> &wanted)
+{
+    for (size_t i = 0; i < txnCounter; ++i)
+        if (txid(i) == wanted)
+            return i;
+
+    return std::nullopt;
+}
+
+uint32_t LazyBlock::bip34_height()
+{
+    const TransactionView &cb = coinbase();
+    if (cb.inputs.empty())
+        throw std::runtime_error("Coinbase has no inputs");
+
+    return ::bip34_height(cb.inputs[0].scriptSig);
+}
+
+std::vector<uint8_t> LazyBlock::calcMerkleRoot(std::vector<std::array<uint8_t, 32>> *txids)
+{
+    if (txids)
+    {
+        txids->clear();
+        txids->reserve(txnCounter);
+    }
+
+    std::vector<std::array<uint8_t, 32>> layer;
+    layer.reserve(txnCounter);
+    for (size_t i = 0; i < txnCounter; ++i)
+    {
+        std::array<uint8_t, 32> id = txid(i);
+        if (txids)
+            txids->push_back(id);
+        layer.push_back(reverse_32(id));
+    }
+
+    return merkle_root(std::move(layer));
+}
@@ -0,0 +1,83 @@
+#ifndef LAZY_BLOCK_H
+#define LAZY_BLOCK_H
+
+#include "block.h"
+#include "transaction_view.h"
+#include <vector>
+#include <memory_resource>
+#include <optional>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// Block that only decodes what is asked for. The constructor reads the
+// record prefix, the header and the tx count. Transaction boundaries are
+// scanned on demand, only as far as the furthest transaction asked for,
+// and a TransactionView is built the first time its transaction is
+// accessed. Meant for queries that touch a few transactions (the coinbase,
+// one txid, a summary); Block is cheaper when every transaction is needed.
+// The record must outlive the LazyBlock. Not thread safe: even the
+// read-only looking queries fill the caches.
+class LazyBlock
+{
+public:
+    // blk_record : [magic bytes] [payload size] [payload], as for Block
+    // Offsets and transactions are allocated from mr
+    explicit LazyBlock(std::span<const uint8_t> blk_record,
+                       std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+    ~LazyBlock();
+
+    // Handed out TransactionView references stay valid for the lifetime
+    LazyBlock(const LazyBlock &) = delete;
+    LazyBlock &operator=(const LazyBlock &) = delete;
+
+    uint32_t getMagicNumber() const { return magic; }
+    uint32_t getSize() const { return blockSize; }
+    const BlockHeader &getHeader() const { return blockHeader; }
+    uint64_t getTransactionCount() const { return txnCounter; }
+
+    // Transaction i, parsed on first access. Throws std::out_of_range if
+    // i >= getTransactionCount(), std::runtime_error if it does not decode.
+    const TransactionView &transaction(size_t i);
+    const TransactionView &coinbase() { return transaction(0); }
+
+    // Display order txid of transaction i, hashed from its bytes without
+    // building the transaction
+    std::array<uint8_t, 32> txid(size_t i);
+
+    // Index of the transaction with this (display order) txid
+    std::optional<size_t> find_txid(const std::array<uint8_t, 32> &txid);
+
+    // BIP 34 height from the coinbase scriptSig, 0 if there is none
+    uint32_t bip34_height();
+
+    // Same as Block::calcMerkleRoot, hashes every transaction but decodes
+    // none. txids (optional) receives the display order txids on the way.
+    std::vector<uint8_t> calcMerkleRoot(std::vector<std::array<uint8_t, 32>> *txids = nullptr);
+
+    // Transactions built so far
+    size_t materialized_count() const { return materialized; }
+
+private:
+    // Byte ranges of transaction i, scanning up to it if needed
+    const TxByteRanges &ranges(size_t i);
+
+    std::span<const uint8_t> record;
+    std::pmr::memory_resource *mr;
+
+    uint32_t magic, blockSize;
+    BlockHeader blockHeader;
+    uint64_t txnCounter;
+
+    // Offset table, one entry per transaction scanned so far
+    std::pmr::vector<TxByteRanges> offsets;
+    size_t scanOffset; // where the next unscanned transaction starts
+
+    // One slot per transaction, built on first access. Pointers so the
+    // references transaction() returns never move.
+    std::pmr::vector<TransactionView *> txs;
+    size_t materialized = 0;
+};
+
+#endif
@@ -1,9 +1,15 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <chrono>
 #include "accounting.h"
 #include "json_helper.h"
 #include "block_parser.h"
+#include "block_follower.h"
+#include "header_scan.h"
+#include "lazy_block.h"
+#include "async_reader.h"
+#include "utilities.h"
 #include <nlohmann/json.hpp>
 
 namespace fs = std::filesystem;
@@ -41,28 +47,326 @@ static int run_tx_mode(const std::string &input_path)
     return 0;
 }
 
+// Trailing options of the block modes
+struct BlockModeOptions
+{
+    unsigned threads = 0;
+    ReadBackend backend = ReadBackend::Mmap;
+    unsigned queue_depth = AsyncFileReader::DEFAULT_QUEUE_DEPTH;
+};
+
+// Which of the options a mode takes, the others are rejected rather than
+// silently ignored
+enum BlockOption : unsigned
+{
+    OPT_THREADS = 1,     // --threads N
+    OPT_BACKEND = 2,     // --io-uring | --direct
+    OPT_QUEUE_DEPTH = 4, // --queue-depth N
+    OPT_ALL = OPT_THREADS | OPT_BACKEND | OPT_QUEUE_DEPTH
+};
+
+// Parses argv[first..argc) as [--threads N] [--io-uring | --direct] [--queue-depth N],
+// limited to the accepted options
+static BlockModeOptions parse_block_options(int argc, char *argv[], int first, unsigned accepted)
+{
+    BlockModeOptions opts;
+
+    for (int i = first; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--io-uring" && (accepted & OPT_BACKEND))
+        {
+            opts.backend = ReadBackend::IoUring;
+            continue;
+        }
+
+        if (arg == "--direct" && (accepted & OPT_BACKEND))
+        {
+            opts.backend = ReadBackend::Direct;
+            continue;
+        }
+
+        bool takes_value = (arg == "--threads" && (accepted & OPT_THREADS)) ||
+                           (arg == "--queue-depth" && (accepted & OPT_QUEUE_DEPTH));
+        if (takes_value && i + 1 < argc)
+        {
+            unsigned value = static_cast<unsigned>(std::stoul(argv[++i]));
+            if (arg == "--threads")
+                opts.threads = value;
+            else
+                opts.queue_depth = value;
+            continue;
+        }
+
+        throw std::runtime_error("Unknown or incomplete option: " + arg);
+    }
+
+    return opts;
+}
+
 static int run_block_mode(const std::string &blk_path,
                           const std::string &rev_path,
-                          const std::string &xor_path)
+                          const std::string &xor_path,
+                          const BlockModeOptions &opts)
 {
     BlockParser parser(blk_path, rev_path, xor_path, "out");
+    parser.set_read_backend(opts.backend, opts.queue_depth);
+    parser.set_decode_threads(opts.threads);
     parser.run();
     return 0;
 }
 
+static int run_block_all_mode(const std::string &blk_path,
+                              const std::string &rev_path,
+                              const std::string &xor_path,
+                              const BlockModeOptions &opts)
+{
+    BlockParser parser(blk_path, rev_path, xor_path, "out");
+    parser.set_read_backend(opts.backend, opts.queue_depth);
+    parser.run_all();
+
+    const BlockParserStats &s = parser.stats();
+    std::cerr << "[summary] blocks=" << s.blocks_written
+              << " records=" << s.records_read
+              << " skipped=" << s.records_skipped
+              << " failed=" << s.blocks_failed
+              << " skipped_ranges=" << s.blk_skipped.size() + s.rev_skipped.size()
+              << " read=" << s.read_backend
+              << " bytes_read=" << s.bytes_read
+              << " cached_before=" << s.cache_resident_before
+              << " cached_after=" << s.cache_resident_after
+              << " allocs=" << s.decode_allocations
+              << " alloc_blocks=" << s.blocks_allocating << "\n";
+    return 0;
+}
+
+// Single block by offsets (two numbers) or by hash with --index <sidecar>
+static int run_block_at_mode(int argc, char *argv[])
+{
+    BlockParser parser(argv[2], argv[3], argv[4], "out");
+    parser.set_decode_threads(0); // one block, spread it over all cores
+    std::string target = argv[5];
+
+    if (argc == 8 && std::string(argv[6]) == "--index")
+        parser.run_hash(target, argv[7]);
+    else if (argc == 7)
+        parser.run_at(std::stoull(target), std::stoull(argv[6]));
+    else
+        throw std::runtime_error("--block-at needs <blk-offset> <rev-offset> or <block-hash> --index <file>");
+
+    return 0;
+}
+
+// Header, tx count and coinbase of one block by offset (or hash with
+// --index <sidecar>), optionally where a txid sits in it. Only the blk
+// record is read and only the coinbase is decoded.
+static int run_block_summary_mode(int argc, char *argv[])
+{
+    std::string blk_path = argv[2];
+    std::string xor_path = argv[3];
+    std::string target = argv[4];
+    int i = 5;
+
+    size_t blk_offset;
+    if (i + 1 < argc && std::string(argv[i]) == "--index")
+    {
+        std::optional<BlockOffsets> offsets = find_in_offset_index(argv[i + 1], target);
+        if (!offsets)
+            throw std::runtime_error("Block not in offset index: " + target);
+        blk_offset = offsets->blk_offset;
+        i += 2;
+    }
+    else
+    {
+        blk_offset = std::stoull(target);
+    }
+
+    std::optional<std::array<uint8_t, 32>> find_txid;
+    if (i + 1 < argc && std::string(argv[i]) == "--txid")
+    {
+        std::vector<uint8_t> bytes = hex_to_bytes(argv[i + 1]);
+        if (bytes.size() != 32)
+            throw std::runtime_error("--txid needs a 32 byte hex txid");
+        find_txid.emplace();
+        std::copy(bytes.begin(), bytes.end(), find_txid->begin());
+        i += 2;
+    }
+
+    if (i != argc)
+        throw std::runtime_error("--block-summary needs <blk.dat> <xor.dat> (<blk-offset> | <block-hash> --index <file>) [--txid <txid>]");
+
+    // Empty xor_path means the file is not obfuscated, as for BlockParser
+    std::vector<uint8_t> xor_key = xor_path.empty() ? std::vector<uint8_t>{} : read_xor_key(xor_path);
+
+    std::vector<uint8_t> buf;
+    std::span<const uint8_t> record = read_record_at(blk_path, blk_offset, 0, xor_key, buf);
+    LazyBlock block(record);
+
+    std::cout << block_summary_to_json(block, find_txid).dump(4) << "\n";
+    return 0;
+}
+
+static int run_build_index_mode(const std::string &blk_path,
+                                const std::string &rev_path,
+                                const std::string &xor_path,
+                                const std::string &index_path)
+{
+    BlockParser parser(blk_path, rev_path, xor_path, "out");
+    size_t lines = parser.build_offset_index(index_path);
+
+    std::cerr << "[summary] indexed=" << lines << " index=" << index_path << "\n";
+    return 0;
+}
+
+static int run_blocks_dir_mode(const std::string &blocks_dir, const BlockModeOptions &opts)
+{
+    BlocksDirParser parser(blocks_dir, "out", opts.threads);
+    parser.set_read_backend(opts.backend, opts.queue_depth);
+    size_t blocks = parser.run();
+
+    uint64_t bytes_read = 0, cached_before = 0, cached_after = 0;
+    for (const BlockFileJob &job : parser.jobs())
+    {
+        bytes_read += job.stats.bytes_read;
+        cached_before += job.stats.cache_resident_before;
+        cached_after += job.stats.cache_resident_after;
+    }
+
+    std::cerr << "[summary] files=" << parser.jobs().size()
+              << " blocks=" << blocks
+              << " bytes_read=" << bytes_read
+              << " cached_before=" << cached_before
+              << " cached_after=" << cached_after << "\n";
+    return 0;
+}
+
+// One JSON line per block header on stdout, chain summary on stderr
+static int run_headers_only_mode(const std::string &path, const BlockModeOptions &opts)
+{
+    HeaderScanner scanner(path, opts.threads);
+    size_t headers = scanner.run();
+
+    for (const HeaderRecord &rec : scanner.records())
+        std::cout << header_record_to_json(rec).dump() << "\n";
+    std::cout.flush();
+
+    std::cerr << "[summary] headers=" << headers
+              << " skipped_ranges=" << scanner.skipped_ranges();
+    if (const HeaderRecord *tip = scanner.tip())
+        std::cerr << " tip=" << bytes_to_hex(tip->info.block_hash)
+                  << " height=" << tip->height;
+    std::cerr << "\n";
+    return 0;
+}
+
+// Tails a live blocks directory, optionally stopping after max_blocks reports
+static int run_follow_mode(int argc, char *argv[])
+{
+    size_t max_blocks = 0;
+    if (argc == 5 && std::string(argv[3]) == "--max-blocks")
+        max_blocks = std::stoull(argv[4]);
+    else if (argc != 3)
+        throw std::runtime_error("--follow needs <blocks-dir> [--max-blocks N]");
+
+    BlocksDirFollower follower(argv[2], "out");
+    follower.run(max_blocks);
+
+    const FollowStats &s = follower.stats();
+    std::cerr << "[summary] blocks=" << s.blocks_written
+              << " failed=" << s.blocks_failed
+              << " skipped=" << s.records_skipped << "\n";
+    return 0;
+}
+
+// Whole-file read throughput: read_file() against AsyncFileReader.
+// Best of a few rounds each, so after the first round both mostly measure
+// the page cache; drop caches beforehand to compare cold reads.
+static int run_bench_read_mode(const std::string &path, const BlockModeOptions &opts)
+{
+    const int rounds = 3;
+
+    auto best_mib_s = [&](auto &&read_once)
+    {
+        double best = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            size_t bytes = read_once();
+            std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+            double mib_s = dt.count() > 0 ? bytes / (1024.0 * 1024.0) / dt.count() : 0;
+            best = std::max(best, mib_s);
+        }
+        return best;
+    };
+
+    bool io_uring = false;
+
+    double sync_mib_s = best_mib_s([&]()
+    {
+        return read_file(path).size();
+    });
+
+    double async_mib_s = best_mib_s([&]()
+    {
+        AsyncFileReader reader(path, opts.queue_depth);
+        io_uring = reader.uses_io_uring();
+        return reader.finish().size();
+    });
+
+    nlohmann::ordered_json j = {
+        {"ok", true},
+        {"file", path},
+        {"bytes", fs::file_size(path)},
+        {"queue_depth", opts.queue_depth},
+        {"io_uring", io_uring},
+        {"read_file_mib_s", sync_mib_s},
+        {"async_reader_mib_s", async_mib_s}};
+
+    std::cout << j.dump(4) << "\n";
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     try
     {
-        if (argc == 5 && std::string(argv[1]) == "--block")
-            return run_block_mode(argv[2], argv[3], argv[4]);
+        std::string mode = argc > 1 ? argv[1] : "";
+
+        if (argc >= 5 && mode == "--block")
+            return run_block_mode(argv[2], argv[3], argv[4], parse_block_options(argc, argv, 5, OPT_ALL));
+
+        if (argc >= 5 && mode == "--block-all")
+            return run_block_all_mode(argv[2], argv[3], argv[4],
+                                      parse_block_options(argc, argv, 5, OPT_BACKEND | OPT_QUEUE_DEPTH));
+
+        if (argc >= 7 && mode == "--block-at")
+            return run_block_at_mode(argc, argv);
+
+        if (argc >= 5 && mode == "--block-summary")
+            return run_block_summary_mode(argc, argv);
+
+        if (argc == 6 && mode == "--build-index")
+            return run_build_index_mode(argv[2], argv[3], argv[4], argv[5]);
+
+        if (argc >= 3 && mode == "--blocks-dir")
+            return run_blocks_dir_mode(argv[2], parse_block_options(argc, argv, 3, OPT_ALL));
+
+        if (argc >= 3 && mode == "--headers-only")
+            return run_headers_only_mode(argv[2], parse_block_options(argc, argv, 3, OPT_THREADS));
+
+        if (argc >= 3 && mode == "--follow")
+            return run_follow_mode(argc, argv);
+
+        if (argc >= 3 && mode == "--bench-read")
+            return run_bench_read_mode(argv[2], parse_block_options(argc, argv, 3, OPT_QUEUE_DEPTH));
 
         if (argc == 2)
             return run_tx_mode(argv[1]);
 
         nlohmann::ordered_json err = {
             {"ok", false},
-            {"error", {{"code", "INVALID_USAGE"}, {"message", "Usage: tx_tool <input.json> | tx_tool --block <blk.dat> <rev.dat> <xor.dat>"}}}};
+            {"error", {{"code", "INVALID_USAGE"}, {"message", "Usage: tx_tool <input.json> | tx_tool --block <blk.dat> <rev.dat> <xor.dat> | tx_tool --block-all <blk.dat> <rev.dat> <xor.dat> [--io-uring | --direct] [--queue-depth N] | tx_tool --block-at <blk.dat> <rev.dat> <xor.dat> (<blk-offset> <rev-offset> | <block-hash> --index <file>) | tx_tool --block-summary <blk.dat> <xor.dat> (<blk-offset> | <block-hash> --index <file>) [--txid <txid>] | tx_tool --build-index <blk.dat> <rev.dat> <xor.dat> <index-file> | tx_tool --blocks-dir <dir> [--threads N] [--io-uring | --direct] [--queue-depth N] | tx_tool --headers-only <dir|blk.dat> [--threads N] | tx_tool --follow <dir> [--max-blocks N] | tx_tool --bench-read <file> [--queue-depth N]. --direct streams the blk file through an 8 MiB buffer and holds only the rev file in memory."}}}};
 
         std::cout << err.dump(4) << "\n";
         return 1;
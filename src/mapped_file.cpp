@@ -0,0 +1,86 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path)
+    : path_(path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("MappedFile: cannot open: " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("MappedFile: cannot stat: " + path);
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+
+    // mmap() rejects zero length mappings, an empty file is just an empty view
+    if (size_ > 0)
+    {
+        void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("MappedFile: mmap failed: " + path);
+        }
+        data_ = static_cast<const uint8_t *>(p);
+    }
+
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+}
+
+MappedFile::MappedFile(const std::string &path, FileBuffer &&contents)
+    : path_(path),
+      owned_(std::move(contents))
+{
+    data_ = owned_.empty() ? nullptr : owned_.data();
+    size_ = owned_.size();
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ && owned_.empty())
+        ::munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+std::span<const uint8_t> MappedFile::slice(size_t offset, size_t len) const
+{
+    if (offset > size_ || len > size_ - offset)
+        throw std::out_of_range("MappedFile: slice out of range: " + path_);
+    return {data_ + offset, len};
+}
+
+void MappedFile::advise_sequential() const
+{
+    if (data_ && owned_.empty())
+        ::madvise(const_cast<uint8_t *>(data_), size_, MADV_SEQUENTIAL);
+}
+
+void MappedFile::advise_random() const
+{
+    if (data_ && owned_.empty())
+        ::madvise(const_cast<uint8_t *>(data_), size_, MADV_RANDOM);
+}
+
+void MappedFile::advise_willneed(size_t offset, size_t len) const
+{
+    if (!data_ || !owned_.empty() || offset >= size_)
+        return;
+
+    // madvise wants a page aligned start address
+    static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t aligned = offset - (offset % page);
+    size_t end = std::min(size_, offset + len);
+
+    ::madvise(const_cast<uint8_t *>(data_) + aligned, end - aligned, MADV_WILLNEED);
+}
@@ -0,0 +1,82 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <span>
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+// std::allocator that leaves elements uninitialized on resize(), for
+// buffers a read is about to overwrite. Zero filling a whole blk file
+// would touch every page before the first read is even submitted.
+template <typename T>
+struct UninitAllocator : std::allocator<T>
+{
+    template <typename U>
+    struct rebind
+    {
+        using other = UninitAllocator<U>;
+    };
+
+    UninitAllocator() = default;
+    template <typename U>
+    UninitAllocator(const UninitAllocator<U> &) noexcept {}
+
+    template <typename U>
+    void construct(U *p) { ::new (static_cast<void *>(p)) U; }
+
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) { ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+};
+
+// Whole file contents loaded by a reader backend
+using FileBuffer = std::vector<uint8_t, UninitAllocator<uint8_t>>;
+
+// Read-only memory mapped view of a whole file (blk*.dat / rev*.dat)
+// Pages are faulted in by the kernel on access, so nothing is copied up front
+// and RSS only grows with the records we actually touch.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+
+    // Same view over contents that another reader backend already loaded
+    // (see AsyncFileReader), the buffer is owned instead of mapped
+    MappedFile(const std::string &path, FileBuffer &&contents);
+    ~MappedFile();
+
+    // Mapping is owned, no copies
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Whole file as a byte span
+    std::span<const uint8_t> bytes() const { return {data_, size_}; }
+
+    // Sub range [offset, offset + len) of the file, throws if out of range
+    std::span<const uint8_t> slice(size_t offset, size_t len) const;
+
+    // madvise hints, both are best effort and silently ignored on failure
+    // MADV_SEQUENTIAL : aggressive read ahead, drop pages behind us sooner
+    void advise_sequential() const;
+    // MADV_RANDOM : no read ahead, for passes that only touch record headers
+    void advise_random() const;
+    // MADV_WILLNEED : start reading the range in the background now
+    void advise_willneed(size_t offset, size_t len) const;
+
+private:
+    std::string path_;
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+
+    // Only used by the owning constructor, data_ points into it
+    FileBuffer owned_;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+unsigned parallel_for_threads(size_t count, unsigned threads, size_t min_per_thread)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t by_size = count / std::max<size_t>(min_per_thread, 1);
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, by_size)));
+}
+
+void parallel_for(size_t count, unsigned threads, size_t min_per_thread,
+                  const std::function<void(size_t begin, size_t end)> &body)
+{
+    unsigned n_threads = parallel_for_threads(count, threads, min_per_thread);
+    if (n_threads == 1)
+    {
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto run_slice = [&](unsigned t)
+    {
+        size_t begin = count * t / n_threads;
+        size_t end = count * (t + 1) / n_threads;
+        try
+        {
+            body(begin, end);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(n_threads - 1);
+    for (unsigned t = 1; t < n_threads; ++t)
+        pool.emplace_back(run_slice, t);
+
+    run_slice(0);
+
+    for (auto &th : pool)
+        th.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
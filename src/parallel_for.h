@@ -0,0 +1,19 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <functional>
+#include <cstddef>
+
+// Splits [0, count) into one contiguous slice per thread and runs
+// body(begin, end) on each, the calling thread takes the first slice.
+// threads == 0 means one per hardware thread; fewer are used if a slice
+// would get less than min_per_thread items, so small inputs stay on the
+// calling thread. The first exception thrown by a slice is rethrown after
+// all threads are joined.
+void parallel_for(size_t count, unsigned threads, size_t min_per_thread,
+                  const std::function<void(size_t begin, size_t end)> &body);
+
+// Number of threads parallel_for would use
+unsigned parallel_for_threads(size_t count, unsigned threads, size_t min_per_thread);
+
+#endif
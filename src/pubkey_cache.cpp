@@ -0,0 +1,63 @@
+#include "pubkey_cache.h"
+#include "byte_reader.h"
+
+#include <algorithm>
+#include <bit>
+
+// Field prime of secp256k1, big endian
+static constexpr std::array<uint8_t, 32> FIELD_P = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xfe, 0xff, 0xff, 0xfc, 0x2f};
+
+// p - y, the y of the other parity (y is never 0 on the curve)
+static std::array<uint8_t, 32> negate_y(const std::array<uint8_t, 32> &y)
+{
+    std::array<uint8_t, 32> r;
+    int borrow = 0;
+    for (size_t i = 32; i-- > 0;)
+    {
+        int d = FIELD_P[i] - y[i] - borrow;
+        borrow = d < 0;
+        r[i] = static_cast<uint8_t>(d + (borrow ? 256 : 0));
+    }
+    return r;
+}
+
+static bool is_odd(const std::array<uint8_t, 32> &y)
+{
+    return y[31] & 1;
+}
+
+PubkeyCache::PubkeyCache(size_t capacity)
+    : slots_(std::bit_ceil(std::max<size_t>(capacity, 1)))
+{
+}
+
+size_t PubkeyCache::slot_of(std::span<const uint8_t, 32> x) const
+{
+    return load_le64(x.data() + 24) & (slots_.size() - 1);
+}
+
+bool PubkeyCache::find(std::span<const uint8_t, 32> x, bool odd, std::array<uint8_t, 32> &y)
+{
+    const Slot &slot = slots_[slot_of(x)];
+    if (!slot.used || !std::equal(x.begin(), x.end(), slot.x.begin()))
+    {
+        misses_++;
+        return false;
+    }
+
+    hits_++;
+    y = odd ? negate_y(slot.even_y) : slot.even_y;
+    return true;
+}
+
+void PubkeyCache::insert(std::span<const uint8_t, 32> x, const std::array<uint8_t, 32> &y)
+{
+    Slot &slot = slots_[slot_of(x)];
+    slot.used = true;
+    std::copy(x.begin(), x.end(), slot.x.begin());
+    slot.even_y = is_odd(y) ? negate_y(y) : y;
+}
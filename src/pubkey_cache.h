@@ -0,0 +1,50 @@
+#ifndef PUBKEY_CACHE_H
+#define PUBKEY_CACHE_H
+
+#include <vector>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// Bounded cache of decompressed secp256k1 pubkeys, keyed by x coordinate.
+// Early chain P2PK coins reuse a small set of keys, so most of their
+// decompressions are lookups. Slots are direct mapped on the low bytes of
+// x (uniformly distributed for real keys) and a new key simply replaces
+// the one in its slot, so memory stays at capacity entries. Each slot keeps
+// the even y; the odd one is p - y, so both parities of a key share a slot.
+// Not thread safe.
+class PubkeyCache
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    // capacity is rounded up to a power of two
+    explicit PubkeyCache(size_t capacity = DEFAULT_CAPACITY);
+
+    // y of the point with this x and parity, if cached
+    bool find(std::span<const uint8_t, 32> x, bool odd, std::array<uint8_t, 32> &y);
+
+    // Caches the y computed for x, of either parity
+    void insert(std::span<const uint8_t, 32> x, const std::array<uint8_t, 32> &y);
+
+    size_t capacity() const { return slots_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    struct Slot
+    {
+        bool used = false;
+        std::array<uint8_t, 32> x;
+        std::array<uint8_t, 32> even_y;
+    };
+
+    size_t slot_of(std::span<const uint8_t, 32> x) const;
+
+    std::vector<Slot> slots_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+#endif
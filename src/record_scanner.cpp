@@ -0,0 +1,291 @@
+#include "record_scanner.h"
+#include "utilities.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Window decoded at a time when searching an obfuscated file
+static constexpr size_t SEARCH_WINDOW = 64 * 1024;
+
+std::span<const uint8_t> load_range(const MappedFile &file,
+                                    size_t offset, size_t len,
+                                    const std::vector<uint8_t> &xor_key,
+                                    std::vector<uint8_t> &scratch)
+{
+    std::span<const uint8_t> raw = file.slice(offset, len);
+    if (xor_key.empty())
+        return raw;
+
+    scratch.assign(raw.begin(), raw.end());
+    xor_decode(std::span<uint8_t>(scratch), xor_key, offset);
+    return scratch;
+}
+
+bool is_known_magic(uint32_t magic)
+{
+    return magic == MAGIC_MAINNET || magic == MAGIC_TESTNET3 || magic == MAGIC_TESTNET4 ||
+           magic == MAGIC_SIGNET || magic == MAGIC_REGTEST;
+}
+
+// pread until len bytes are in or the file ends, returns bytes read
+static size_t pread_full(int fd, uint8_t *dst, size_t len, size_t offset)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = ::pread(fd, dst + done, len - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+std::span<const uint8_t> read_record_at(const std::string &path,
+                                        size_t offset, size_t trailer_size,
+                                        const std::vector<uint8_t> &xor_key,
+                                        std::vector<uint8_t> &buf)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open file: " + path);
+
+    std::string where = path + " offset " + std::to_string(offset);
+
+    buf.resize(8);
+    if (pread_full(fd, buf.data(), 8, offset) != 8)
+    {
+        ::close(fd);
+        throw std::runtime_error("No record at " + where + ": past end of file");
+    }
+    xor_decode(std::span<uint8_t>(buf), xor_key, offset);
+
+    if (!is_known_magic(read_uint32_le(buf, 0)))
+    {
+        ::close(fd);
+        throw std::runtime_error("No record at " + where + ": bad magic");
+    }
+
+    size_t payload = read_uint32_le(buf, 4);
+    size_t max_payload = trailer_size > 0 ? MAX_UNDO_SIZE : MAX_BLOCK_SERIALIZED_SIZE;
+    if (payload == 0 || payload > max_payload)
+    {
+        ::close(fd);
+        throw std::runtime_error("No record at " + where + ": invalid record size");
+    }
+
+    size_t total = 8 + payload + trailer_size;
+    buf.resize(total);
+    size_t got = pread_full(fd, buf.data() + 8, total - 8, offset + 8);
+    ::close(fd);
+
+    if (got != total - 8)
+        throw std::runtime_error("No record at " + where + ": truncated record");
+
+    xor_decode(std::span<uint8_t>(buf).subspan(8), xor_key, offset + 8);
+    return buf;
+}
+
+// Position of the 4 byte pattern in data (data.size() if absent).
+// nonzero is set if any byte before the returned position is non zero.
+// The SSE2 path compares 16 candidates for the first byte per step, so runs
+// of zero padding go by 16 bytes at a time.
+static size_t find4(std::span<const uint8_t> data, const uint8_t pattern[4], bool &nonzero)
+{
+    const uint8_t *p = data.data();
+    size_t n = data.size();
+    size_t i = 0;
+
+    auto any_nonzero = [&](size_t from, size_t to)
+    {
+        for (size_t j = from; j < to; ++j)
+            if (p[j] != 0)
+                return true;
+        return false;
+    };
+
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(static_cast<char>(pattern[0]));
+    __m128i seen = _mm_setzero_si128();
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, first)));
+
+        while (mask)
+        {
+            size_t c = i + static_cast<size_t>(__builtin_ctz(mask));
+            if (c + 4 <= n && std::memcmp(p + c, pattern, 4) == 0)
+            {
+                bool block_nonzero =
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(seen, _mm_setzero_si128())) != 0xFFFF;
+                nonzero = nonzero || block_nonzero || any_nonzero(i, c);
+                return c;
+            }
+            mask &= mask - 1;
+        }
+
+        seen = _mm_or_si128(seen, v);
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(seen, _mm_setzero_si128())) != 0xFFFF)
+        nonzero = true;
+#endif
+
+    for (; i < n; ++i)
+    {
+        if (i + 4 <= n && p[i] == pattern[0] && std::memcmp(p + i, pattern, 4) == 0)
+            return i;
+        if (p[i] != 0)
+            nonzero = true;
+    }
+    return n;
+}
+
+RecordScanner::RecordScanner(const MappedFile &file,
+                             const std::vector<uint8_t> &xor_key,
+                             size_t trailer_size,
+                             size_t min_payload,
+                             size_t max_payload)
+    : file_(file),
+      xor_key_(xor_key),
+      trailer_size_(trailer_size),
+      min_payload_(min_payload),
+      max_payload_(max_payload)
+{
+    // Take the network from the first record, mainnet if it is not recognisable
+    if (file_.size() >= 4)
+    {
+        uint32_t first = read_uint32_le(load_range(file_, 0, 4, xor_key_, scratch_), 0);
+        if (is_known_magic(first))
+            magic_ = first;
+    }
+}
+
+RecordScanner RecordScanner::for_blk(const MappedFile &file, const std::vector<uint8_t> &xor_key)
+{
+    // payload = header (80) + at least one byte of tx count
+    return RecordScanner(file, xor_key, 0, 80 + 1, MAX_BLOCK_SERIALIZED_SIZE);
+}
+
+RecordScanner RecordScanner::for_rev(const MappedFile &file, const std::vector<uint8_t> &xor_key)
+{
+    // payload = at least the tx count, followed by a 32 byte checksum
+    return RecordScanner(file, xor_key, 32, 1, MAX_UNDO_SIZE);
+}
+
+size_t RecordScanner::find_magic(size_t from, bool &all_zero)
+{
+    const size_t size = file_.size();
+    uint8_t pattern[4] = {
+        static_cast<uint8_t>(magic_),
+        static_cast<uint8_t>(magic_ >> 8),
+        static_cast<uint8_t>(magic_ >> 16),
+        static_cast<uint8_t>(magic_ >> 24)};
+
+    bool nonzero = false;
+    size_t pos = from;
+
+    while (pos < size)
+    {
+        // Plain files are searched in place, obfuscated ones a window at a time
+        size_t len = xor_key_.empty() ? size - pos : std::min(SEARCH_WINDOW, size - pos);
+        std::span<const uint8_t> win = load_range(file_, pos, len, xor_key_, scratch_);
+
+        size_t hit = find4(win, pattern, nonzero);
+        if (hit < len)
+        {
+            all_zero = !nonzero;
+            return pos + hit;
+        }
+
+        if (pos + len >= size)
+            break;
+
+        // Overlap by 3 so a magic split across two windows is still found,
+        // those 3 bytes were already checked for being zero
+        pos += len - 3;
+    }
+
+    all_zero = !nonzero;
+    return size;
+}
+
+void add_skipped_range(std::vector<SkippedRange> &ranges,
+                       size_t from, size_t to, const std::string &reason)
+{
+    if (to <= from)
+        return;
+
+    if (!ranges.empty())
+    {
+        SkippedRange &last = ranges.back();
+        if (last.offset + last.length == from && last.reason == reason)
+        {
+            last.length += to - from;
+            return;
+        }
+    }
+
+    ranges.push_back({from, to - from, reason});
+}
+
+bool RecordScanner::next(DatRecord &rec)
+{
+    const size_t size = file_.size();
+
+    while (pos_ < size)
+    {
+        if (pos_ + 8 > size)
+        {
+            bool all_zero = false;
+            find_magic(pos_, all_zero);
+            skip(pos_, size, all_zero ? "zero padding" : "truncated record");
+            pos_ = size;
+            break;
+        }
+
+        std::span<const uint8_t> prefix = load_range(file_, pos_, 8, xor_key_, scratch_);
+
+        if (read_uint32_le(prefix, 0) != magic_)
+        {
+            bool all_zero = false;
+            size_t found = find_magic(pos_, all_zero);
+            skip(pos_, found, all_zero ? "zero padding" : "unframed bytes");
+            pos_ = found;
+            continue;
+        }
+
+        size_t payload = read_uint32_le(prefix, 4);
+        size_t total = 8 + payload + trailer_size_;
+
+        // Corrupt size or cut off record: resync on the next magic after this one
+        if (payload < min_payload_ || payload > max_payload_ || pos_ + total > size)
+        {
+            bool all_zero = false;
+            size_t found = find_magic(pos_ + 4, all_zero);
+            bool bad_size = payload < min_payload_ || payload > max_payload_;
+            skip(pos_, found, bad_size ? "invalid record size" : "truncated record");
+            pos_ = found;
+            continue;
+        }
+
+        rec.offset = pos_;
+        rec.size = total;
+        pos_ += total;
+        return true;
+    }
+
+    return false;
+}
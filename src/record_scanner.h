@@ -0,0 +1,115 @@
+#ifndef RECORD_SCANNER_H
+#define RECORD_SCANNER_H
+
+#include "mapped_file.h"
+
+#include <string>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// Network magic bytes that start every record of blk*.dat / rev*.dat
+// (as a little endian uint32, i.e. the first byte is the low byte)
+constexpr uint32_t MAGIC_MAINNET  = 0xD9B4BEF9;
+constexpr uint32_t MAGIC_TESTNET3 = 0x0709110B;
+constexpr uint32_t MAGIC_TESTNET4 = 0x283F161C;
+constexpr uint32_t MAGIC_SIGNET   = 0x40CF030A;
+constexpr uint32_t MAGIC_REGTEST  = 0xDAB5BFFA;
+
+// Largest serialized block (BIP 141) and Bitcoin Core's MAX_SIZE for undo data
+constexpr size_t MAX_BLOCK_SERIALIZED_SIZE = 4'000'000;
+constexpr size_t MAX_UNDO_SIZE = 0x02000000;
+
+// True for any of the network magics above
+bool is_known_magic(uint32_t magic);
+
+// Returns a view of [offset, offset + len) of a mapped .dat file.
+// Plain files are parsed straight out of the mapping, obfuscated ones are
+// decoded into scratch so the mapping itself stays read only.
+std::span<const uint8_t> load_range(const MappedFile &file,
+                                    size_t offset, size_t len,
+                                    const std::vector<uint8_t> &xor_key,
+                                    std::vector<uint8_t> &scratch);
+
+// Reads the single record that starts at offset with pread, without mapping
+// or reading anything else of the file, and decodes it into buf.
+// trailer_size as for RecordScanner (32 for rev files). Throws if the offset
+// does not hold a record.
+std::span<const uint8_t> read_record_at(const std::string &path,
+                                        size_t offset, size_t trailer_size,
+                                        const std::vector<uint8_t> &xor_key,
+                                        std::vector<uint8_t> &buf);
+
+// Byte range of a file that did not hold a usable record
+struct SkippedRange
+{
+    size_t offset = 0;
+    size_t length = 0;
+    std::string reason; // "zero padding", "unframed bytes", "invalid record size", ...
+};
+
+// Appends [from, to) to ranges, merging with the last range if adjacent
+// and skipped for the same reason
+void add_skipped_range(std::vector<SkippedRange> &ranges,
+                       size_t from, size_t to, const std::string &reason);
+
+// One framed record: [magic (4)] [payload size (4)] [payload] [trailer]
+struct DatRecord
+{
+    size_t offset = 0; // position of the magic in the file
+    size_t size = 0;   // whole record, prefix and trailer included
+};
+
+// Walks the framed records of a blk or rev file without ever throwing on bad
+// data. Zero padding (Bitcoin Core preallocates these files) and anything
+// that does not frame as a record is skipped with a vectorized search for the
+// next network magic, and reported through skipped().
+class RecordScanner
+{
+public:
+    // trailer_size : bytes after the payload (32 byte checksum in rev files)
+    // min_payload / max_payload : sizes outside this range are treated as corrupt
+    RecordScanner(const MappedFile &file,
+                  const std::vector<uint8_t> &xor_key,
+                  size_t trailer_size,
+                  size_t min_payload,
+                  size_t max_payload);
+
+    // Scanners for the two file kinds
+    static RecordScanner for_blk(const MappedFile &file, const std::vector<uint8_t> &xor_key);
+    static RecordScanner for_rev(const MappedFile &file, const std::vector<uint8_t> &xor_key);
+
+    // Finds the next record, false once the end of the file is reached
+    bool next(DatRecord &rec);
+
+    // Continues the scan at offset, e.g. where a previous pass stopped
+    void seek(size_t offset) { pos_ = offset; }
+
+    uint32_t magic() const { return magic_; }
+    const std::vector<SkippedRange> &skipped() const { return skipped_; }
+
+private:
+    // Offset of the first magic at or after from, file size if there is none.
+    // Sets all_zero to whether every byte in [from, result) was zero.
+    size_t find_magic(size_t from, bool &all_zero);
+
+    void skip(size_t from, size_t to, const std::string &reason)
+    {
+        add_skipped_range(skipped_, from, to, reason);
+    }
+
+    const MappedFile &file_;
+    const std::vector<uint8_t> &xor_key_;
+    size_t trailer_size_;
+    size_t min_payload_;
+    size_t max_payload_;
+
+    uint32_t magic_ = MAGIC_MAINNET;
+    size_t pos_ = 0;
+
+    std::vector<uint8_t> scratch_;
+    std::vector<SkippedRange> skipped_;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "record_stream.h"
+#include "utilities.h"
+
+#include <algorithm>
+
+// Read ahead per refill, also the most the buffer holds beyond one record
+static constexpr size_t STREAM_CHUNK = 64 * 1024;
+
+DatRecordStream::DatRecordStream(const std::string &path,
+                                 const std::vector<uint8_t> &xor_key,
+                                 size_t trailer_size,
+                                 size_t min_payload,
+                                 size_t max_payload,
+                                 bool direct)
+    : reader_(path, xor_key, direct),
+      trailer_size_(trailer_size),
+      min_payload_(min_payload),
+      max_payload_(max_payload)
+{
+}
+
+DatRecordStream DatRecordStream::for_blk(const std::string &path,
+                                         const std::vector<uint8_t> &xor_key,
+                                         bool direct)
+{
+    // payload = header (80) + at least one byte of tx count, as RecordScanner::for_blk
+    return DatRecordStream(path, xor_key, 0, 80 + 1, MAX_BLOCK_SERIALIZED_SIZE, direct);
+}
+
+bool DatRecordStream::fill(size_t n)
+{
+    if (available() >= n)
+        return true;
+
+    // Move what is left of the previous record out of the way
+    if (head_ > 0)
+    {
+        buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(head_));
+        buf_offset_ += head_;
+        head_ = 0;
+    }
+
+    while (!eof_ && buf_.size() < n)
+    {
+        size_t want = std::max(n - buf_.size(), STREAM_CHUNK);
+        size_t old = buf_.size();
+        buf_.resize(old + want);
+
+        size_t got = reader_.read_some(std::span<uint8_t>(buf_).subspan(old));
+        buf_.resize(old + got);
+        if (got < want)
+            eof_ = true;
+    }
+
+    return buf_.size() >= n;
+}
+
+void DatRecordStream::skip(size_t n)
+{
+    const uint8_t *p = buf_.data() + head_;
+    bool zero = std::all_of(p, p + n, [](uint8_t b)
+                            { return b == 0; });
+
+    size_t from = static_cast<size_t>(buf_offset_ + head_);
+    add_skipped_range(skipped_, from, from + n, zero ? "zero padding" : "unframed bytes");
+    head_ += n;
+}
+
+bool DatRecordStream::next(std::span<const uint8_t> &record, size_t &offset)
+{
+    while (fill(8))
+    {
+        const uint8_t *p = buf_.data() + head_;
+        uint32_t magic = read_uint32_le(std::span<const uint8_t>(p, 4), 0);
+
+        if (magic_ == 0)
+            magic_ = is_known_magic(magic) ? magic : MAGIC_MAINNET;
+
+        if (magic != magic_)
+        {
+            // Skip up to the next magic in what is buffered, keeping 3 bytes
+            // in case the magic straddles the next refill
+            const uint8_t pattern[4] = {
+                static_cast<uint8_t>(magic_),
+                static_cast<uint8_t>(magic_ >> 8),
+                static_cast<uint8_t>(magic_ >> 16),
+                static_cast<uint8_t>(magic_ >> 24)};
+
+            const uint8_t *end = buf_.data() + buf_.size();
+            const uint8_t *hit = std::search(p + 1, end, pattern, pattern + 4);
+            skip(hit != end ? static_cast<size_t>(hit - p) : available() - 3);
+            continue;
+        }
+
+        size_t payload = read_uint32_le(std::span<const uint8_t>(p, 8), 4);
+        if (payload < min_payload_ || payload > max_payload_)
+        {
+            size_t from = static_cast<size_t>(buf_offset_ + head_);
+            add_skipped_range(skipped_, from, from + 4, "invalid record size");
+            head_ += 4;
+            continue;
+        }
+
+        size_t total = 8 + payload + trailer_size_;
+        if (!fill(total))
+        {
+            size_t from = static_cast<size_t>(buf_offset_ + head_);
+            add_skipped_range(skipped_, from, from + available(), "truncated record");
+            head_ = buf_.size();
+            return false;
+        }
+
+        record = std::span<const uint8_t>(buf_.data() + head_, total);
+        offset = static_cast<size_t>(buf_offset_ + head_);
+        head_ += total;
+        return true;
+    }
+
+    // Fewer than 8 bytes left
+    if (available() > 0)
+        skip(available());
+    return false;
+}
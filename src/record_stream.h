@@ -0,0 +1,68 @@
+#ifndef RECORD_STREAM_H
+#define RECORD_STREAM_H
+
+#include "block_parser.h"
+#include "record_scanner.h"
+
+#include <string>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// RecordScanner for inputs that can only be read front to back (stdin, a
+// pipe from a decompressor). Records are read through a DatFileReader into
+// one reused buffer that only ever holds the current record plus a little
+// read ahead, so memory stays at about one block whatever the file size.
+// Padding and unframed bytes are skipped the same way as RecordScanner does.
+class DatRecordStream
+{
+public:
+    // trailer_size / min_payload / max_payload as for RecordScanner
+    // direct as for DatFileReader
+    DatRecordStream(const std::string &path,
+                    const std::vector<uint8_t> &xor_key,
+                    size_t trailer_size,
+                    size_t min_payload,
+                    size_t max_payload,
+                    bool direct = false);
+
+    static DatRecordStream for_blk(const std::string &path, const std::vector<uint8_t> &xor_key,
+                                   bool direct = false);
+
+    // Next complete record, prefix included and already decoded. The view is
+    // valid until the next call. offset is the record's position in the input.
+    bool next(std::span<const uint8_t> &record, size_t &offset);
+
+    const std::vector<SkippedRange> &skipped() const { return skipped_; }
+
+    // Bytes pulled from the input so far
+    uint64_t bytes_read() const { return reader_.offset(); }
+
+    bool uses_o_direct() const { return reader_.uses_o_direct(); }
+
+private:
+    // Makes sure at least n unconsumed bytes are buffered, false at the end
+    bool fill(size_t n);
+
+    size_t available() const { return buf_.size() - head_; }
+
+    // Drops n bytes from the front as skipped
+    void skip(size_t n);
+
+    DatFileReader reader_;
+    size_t trailer_size_;
+    size_t min_payload_;
+    size_t max_payload_;
+
+    uint32_t magic_ = 0; // taken from the first record
+
+    std::vector<uint8_t> buf_;
+    size_t head_ = 0;        // first unconsumed byte in buf_
+    uint64_t buf_offset_ = 0; // input offset of buf_[0]
+    bool eof_ = false;
+
+    std::vector<SkippedRange> skipped_;
+};
+
+#endif
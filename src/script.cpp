@@ -139,10 +139,22 @@ static const std::map<uint8_t, std::string> opcode_map =
         {OP_INVALIDOPCODE, "OP_INVALIDOPCODE"}};
 
 
-// Disassemble byte script to ASM string
-std::string disassemble_script(const std::vector<uint8_t> &script)
+// Appends bytes as lower case hex
+template <typename String>
+static void append_hex(String &out, std::span<const uint8_t> bytes)
+{
+    static const char *hex_chars = "0123456789abcdef";
+    for (uint8_t b : bytes)
+    {
+        out.push_back(hex_chars[b >> 4]);
+        out.push_back(hex_chars[b & 0x0F]);
+    }
+}
+
+// Disassembles script into result, String is std::string or std::pmr::string
+template <typename String>
+static void disassemble_into(std::span<const uint8_t> script, String &result)
 {
-    std::string result;
     size_t i = 0;
 
     while (i < script.size())
@@ -157,13 +169,10 @@ std::string disassemble_script(const std::vector<uint8_t> &script)
             size_t avail = script.size() - i;
             size_t take  = (opcode <= avail) ? opcode : avail;
 
-            std::vector<uint8_t> data(
-                script.begin() + i,
-                script.begin() + i + take);
-
-            result += "OP_PUSHBYTES_" + std::to_string(opcode);
+            result += "OP_PUSHBYTES_";
+            result += std::to_string(opcode);
             result += " ";
-            result += bytes_to_hex(data);
+            append_hex(result, script.subspan(i, take));
 
             i += take;
         }
@@ -181,12 +190,8 @@ std::string disassemble_script(const std::vector<uint8_t> &script)
             size_t avail   = script.size() - i;
             size_t take    = (length <= avail) ? length : avail;
 
-            std::vector<uint8_t> data(
-                script.begin() + i,
-                script.begin() + i + take);
-
             result += "OP_PUSHDATA1 ";
-            result += bytes_to_hex(data);
+            append_hex(result, script.subspan(i, take));
 
             i += take;
         }
@@ -205,12 +210,8 @@ std::string disassemble_script(const std::vector<uint8_t> &script)
             size_t avail = script.size() - i;
             size_t take  = (length <= avail) ? static_cast<size_t>(length) : avail;
 
-            std::vector<uint8_t> data(
-                script.begin() + i,
-                script.begin() + i + take);
-
             result += "OP_PUSHDATA2 ";
-            result += bytes_to_hex(data);
+            append_hex(result, script.subspan(i, take));
 
             i += take;
         }
@@ -231,12 +232,8 @@ std::string disassemble_script(const std::vector<uint8_t> &script)
                                ? static_cast<size_t>(length)
                                : avail;
 
-            std::vector<uint8_t> data(
-                script.begin() + i,
-                script.begin() + i + take);
-
             result += "OP_PUSHDATA4 ";
-            result += bytes_to_hex(data);
+            append_hex(result, script.subspan(i, take));
 
             i += take;
         }
@@ -260,7 +257,21 @@ std::string disassemble_script(const std::vector<uint8_t> &script)
         if (i < script.size())
             result += " ";
     }
+}
 
+// Disassemble byte script to ASM string
+std::string disassemble_script(std::span<const uint8_t> script)
+{
+    std::string result;
+    disassemble_into(script, result);
+    return result;
+}
+
+std::pmr::string disassemble_script(std::span<const uint8_t> script,
+                                    std::pmr::memory_resource *mr)
+{
+    std::pmr::string result(mr);
+    disassemble_into(script, result);
     return result;
 }
 
@@ -272,7 +283,7 @@ std::string disassemble_script_hex(const std::string &hex_script)
 }
 
 // Script classification
-OutputScriptType classify_output_script(const std::vector<uint8_t> &script)
+OutputScriptType classify_output_script(std::span<const uint8_t> script)
 {
     // P2PKH: OP_DUP OP_HASH160 OP_PUSHBYTES_20 <20B> OP_EQUALVERIFY OP_CHECKSIG
     if (script.size() == 25 &&
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <span>
+#include <memory_resource>
 #include <map>
 
 // opcode enum
@@ -162,15 +164,19 @@ enum class OutputScriptType {
 };
 
 
-// Disassembles a raw script (byte vector) into ASM string.
+// Disassembles a raw script (byte vector or a view of one) into ASM string.
 
-std::string disassemble_script(const std::vector<uint8_t>& script);
+std::string disassemble_script(std::span<const uint8_t> script);
+
+// Same, the string is allocated from mr
+std::pmr::string disassemble_script(std::span<const uint8_t> script,
+                                    std::pmr::memory_resource *mr);
 
 // Convenience helper:
 // Takes hex-encoded script and returns ASM representation.
 std::string disassemble_script_hex(const std::string& hex_script);
 
 // Classsifies an output script into OutputScriptType , look above
-OutputScriptType classify_output_script(const std::vector<uint8_t>& script);
+OutputScriptType classify_output_script(std::span<const uint8_t> script);
 
 #endif
@@ -2,11 +2,11 @@
 
 // Extract last pushed data element from script
 // Used for redeemScript detection in P2SH inputs
-static std::optional<std::vector<uint8_t>>
-extract_last_push(const std::vector<uint8_t>& script)
+static std::optional<std::span<const uint8_t>>
+extract_last_push(std::span<const uint8_t> script)
 {
     size_t i = 0;
-    std::vector<uint8_t> last;
+    std::span<const uint8_t> last;
 
     while (i < script.size())
     {
@@ -43,8 +43,7 @@ extract_last_push(const std::vector<uint8_t>& script)
         if (i + length > script.size())
             return std::nullopt;
 
-        last.assign(script.begin() + i,
-                    script.begin() + i + length);
+        last = script.subspan(i, length);
 
         i += length;
     }
@@ -57,7 +56,7 @@ extract_last_push(const std::vector<uint8_t>& script)
 
 // Parse OP_RETURN payload
 static OPReturnPayload
-parse_op_return(const std::vector<uint8_t>& script)
+parse_op_return(std::span<const uint8_t> script)
 {
     OPReturnPayload payload;
     payload.protocol = OPReturnProtocol::UNKNOWN;
@@ -143,10 +142,16 @@ parse_op_return(const std::vector<uint8_t>& script)
 
 
 ProcessedScriptPubKey
-process_output_script(const std::vector<uint8_t>& script)
+process_output_script(std::span<const uint8_t> script)
+{
+    return process_output_script(script, classify_output_script(script));
+}
+
+ProcessedScriptPubKey
+process_output_script(std::span<const uint8_t> script, OutputScriptType type)
 {
     ProcessedScriptPubKey result;
-    result.type = classify_output_script(script);
+    result.type = type;
 
     switch (result.type)
     {
@@ -212,14 +217,37 @@ process_output_script(const std::vector<uint8_t>& script)
     return result;
 }
 
+ProcessedScriptPubKey
+process_compressed_script(const CompressedScript &script)
+{
+    if (!script.is_special())
+        return process_output_script(script.payload());
+
+    ProcessedScriptPubKey result;
+    result.type = script.output_type();
+
+    std::span<const uint8_t> payload = script.payload();
+    if (result.type == OutputScriptType::P2PKH)
+        result.address = encode_p2pkh_address(std::vector<uint8_t>(payload.begin(), payload.end()));
+    else if (result.type == OutputScriptType::P2SH)
+        result.address = encode_p2sh_address(std::vector<uint8_t>(payload.begin(), payload.end()));
+
+    return result;
+}
+
 InputScriptType
-classify_input(const std::vector<uint8_t>& prevout_script,
-               const std::vector<uint8_t>& scriptSig,
-               const std::vector<std::vector<uint8_t>>& witness)
+classify_input(std::span<const uint8_t> prevout_script,
+               std::span<const uint8_t> scriptSig,
+               std::span<const std::span<const uint8_t>> witness)
 {
-    OutputScriptType prev_type =
-        classify_output_script(prevout_script);
+    return classify_input(classify_output_script(prevout_script), scriptSig, witness);
+}
 
+InputScriptType
+classify_input(OutputScriptType prev_type,
+               std::span<const uint8_t> scriptSig,
+               std::span<const std::span<const uint8_t>> witness)
+{
     switch (prev_type)
     {
         case OutputScriptType::P2PKH:
@@ -2,6 +2,7 @@
 #define SCRIPT_PROCESSOR_H
 
 #include "script.h"
+#include "compressed_script.h"
 #include <optional>
 #include "utilities.h"
 
@@ -34,12 +35,26 @@ struct ProcessedScriptPubKey {
     std::optional<OPReturnPayload> op_return;
 };
 
-ProcessedScriptPubKey process_output_script(const std::vector<uint8_t>& script);
+ProcessedScriptPubKey process_output_script(std::span<const uint8_t> script);
 
+// Same, for a script already classified as type
+ProcessedScriptPubKey process_output_script(std::span<const uint8_t> script, OutputScriptType type);
+
+// Same result as process_output_script() on the decompressed script, the
+// type and address come from the tag and hash without rebuilding it
+ProcessedScriptPubKey process_compressed_script(const CompressedScript &script);
+
+// witness: the input's witness stack, one view per item
+InputScriptType classify_input(
+    std::span<const uint8_t> prevout_script,
+    std::span<const uint8_t> scriptSig,
+    std::span<const std::span<const uint8_t>> witness);
+
+// Same, for a prevout whose type is already known
 InputScriptType classify_input(
-    const std::vector<uint8_t>& prevout_script,
-    const std::vector<uint8_t>& scriptSig,
-    const std::vector<std::vector<uint8_t>>& witness);
+    OutputScriptType prevout_type,
+    std::span<const uint8_t> scriptSig,
+    std::span<const std::span<const uint8_t>> witness);
 
 // declarations only — defined in script_processor.cpp
 std::string input_script_type_str(InputScriptType t);
@@ -0,0 +1,117 @@
+#include "small_script.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+Script::Script(const Script &other)
+    : mr_(other.mr_)
+{
+    assign(other);
+}
+
+Script::Script(Script &&other) noexcept
+    : mr_(other.mr_), size_(other.size_), capacity_(other.capacity_)
+{
+    if (other.is_inline())
+    {
+        std::memcpy(inline_, other.inline_, size_);
+    }
+    else
+    {
+        heap_ = other.heap_;
+        other.capacity_ = INLINE_CAPACITY;
+    }
+    other.size_ = 0;
+}
+
+Script &Script::operator=(const Script &other)
+{
+    if (this != &other)
+        assign(other);
+    return *this;
+}
+
+// Takes the buffer only if both sides use the same resource, as a pmr
+// vector would
+Script &Script::operator=(Script &&other)
+{
+    if (this == &other)
+        return *this;
+
+    if (other.is_inline() || mr_ != other.mr_)
+    {
+        assign(other);
+        return *this;
+    }
+
+    release();
+    heap_ = other.heap_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.capacity_ = INLINE_CAPACITY;
+    other.size_ = 0;
+    return *this;
+}
+
+Script::~Script()
+{
+    release();
+}
+
+void Script::release()
+{
+    if (!is_inline())
+        mr_->deallocate(heap_, capacity_, 1);
+    capacity_ = INLINE_CAPACITY;
+}
+
+void Script::reserve(size_t n)
+{
+    if (n <= capacity_)
+        return;
+    if (n > std::numeric_limits<uint32_t>::max())
+        throw std::length_error("Script: too long");
+
+    uint8_t *buf = static_cast<uint8_t *>(mr_->allocate(n, 1));
+    std::memcpy(buf, data(), size_);
+
+    release();
+    heap_ = buf;
+    capacity_ = static_cast<uint32_t>(n);
+}
+
+// Room for n more bytes, growing geometrically so appending byte by byte
+// stays amortized O(1)
+void Script::grow_for(size_t n)
+{
+    size_t need = size_t(size_) + n;
+    if (need > capacity_)
+        reserve(std::max<size_t>(need, std::min<size_t>(size_t(capacity_) * 2,
+                                                        std::numeric_limits<uint32_t>::max())));
+}
+
+// bytes must not point into this script
+void Script::assign(std::span<const uint8_t> bytes)
+{
+    size_ = 0;
+    reserve(bytes.size()); // exact, most scripts are assigned once
+    append(bytes);
+}
+
+void Script::push_back(uint8_t b)
+{
+    grow_for(1);
+    buffer()[size_++] = b;
+}
+
+void Script::append(std::span<const uint8_t> bytes)
+{
+    if (bytes.empty())
+        return;
+
+    grow_for(bytes.size());
+    std::memcpy(buffer() + size_, bytes.data(), bytes.size());
+    size_ += static_cast<uint32_t>(bytes.size());
+}
@@ -0,0 +1,81 @@
+#ifndef SMALL_SCRIPT_H
+#define SMALL_SCRIPT_H
+
+#include <memory_resource>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// Script bytes with small buffer storage: up to INLINE_CAPACITY bytes live
+// in the object itself, longer scripts go to a buffer from mr. Standard
+// output scripts (P2PKH 25, P2SH 23, P2WPKH 22, P2WSH / P2TR 34 bytes) and
+// empty segwit scriptSigs never allocate.
+// Contiguous like a vector, so it converts to std::span<const uint8_t>.
+class Script
+{
+public:
+    static constexpr size_t INLINE_CAPACITY = 40;
+
+    Script()
+        : mr_(std::pmr::get_default_resource())
+    {
+    }
+
+    explicit Script(std::pmr::memory_resource *mr)
+        : mr_(mr)
+    {
+    }
+
+    Script(std::span<const uint8_t> bytes,
+           std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+        : mr_(mr)
+    {
+        assign(bytes);
+    }
+
+    // Copies use the source's memory resource
+    Script(const Script &other);
+    Script(Script &&other) noexcept;
+    Script &operator=(const Script &other);
+    Script &operator=(Script &&other);
+    ~Script();
+
+    const uint8_t *data() const { return is_inline() ? inline_ : heap_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+
+    const uint8_t *begin() const { return data(); }
+    const uint8_t *end() const { return data() + size_; }
+    uint8_t operator[](size_t i) const { return data()[i]; }
+
+    // Keeps the capacity, a heap buffer included
+    void clear() { size_ = 0; }
+    void reserve(size_t n);
+
+    void assign(std::span<const uint8_t> bytes);
+    template <typename It>
+    void assign(It first, It last) { assign(std::span<const uint8_t>(first, last)); }
+
+    void push_back(uint8_t b);
+    void append(std::span<const uint8_t> bytes);
+
+    std::pmr::memory_resource *resource() const { return mr_; }
+
+private:
+    bool is_inline() const { return capacity_ == INLINE_CAPACITY; }
+    uint8_t *buffer() { return is_inline() ? inline_ : heap_; }
+    void grow_for(size_t n);
+    void release();
+
+    std::pmr::memory_resource *mr_;
+    uint32_t size_ = 0;
+    uint32_t capacity_ = INLINE_CAPACITY;
+    union
+    {
+        uint8_t inline_[INLINE_CAPACITY];
+        uint8_t *heap_;
+    };
+};
+
+#endif
@@ -1,4 +1,7 @@
 #include "transaction.h"
+#include "byte_reader.h"
+
+#include <algorithm>
 
 // TxIn
 
@@ -12,12 +15,19 @@ bool TxIn::RLT_enabled() const
 
 // Returns an object with all relative locktime data calculated
 RelativeLocktimeInfo TxIn::get_rlt_info() const
+{
+    return rlt_info_from_sequence(sequence);
+}
+
+// Relative locktime data for an input's sequence field
+RelativeLocktimeInfo rlt_info_from_sequence(uint32_t sequence)
 {
     RelativeLocktimeInfo info{};
     info.enabled = false;
     info.value = 0;
 
-    if (!RLT_enabled())
+    // Disabled if bit 31 is set
+    if (sequence & (1u << 31))
         return info;
 
     info.enabled = true;
@@ -47,212 +57,193 @@ Transaction::Transaction()
     isSegwit = false;
     TxIdHash.fill(0);
     WTxIdHash.fill(0);
+    sizeBytes = 0;
+    witnessBytes = 0;
 }
 
+// Smallest serialized input (prevout, empty script, sequence) and output
+// (amount, empty script), used to cap reserve() on corrupt counts
+static constexpr size_t MIN_INPUT_SIZE = 41;
+static constexpr size_t MIN_OUTPUT_SIZE = 9;
+
 // Constructor that builds Transaction using the raw transaction array of bytes
+// The bytes are untrusted and read once, every field bounds checked
 Transaction::Transaction(const std::vector<uint8_t> &raw)
 {
-    size_t offset = 0;
-
     if (raw.size() < 4)
         throw std::runtime_error("Transaction: raw data too short");
 
+    ByteReader<CheckedBounds> r(raw, 0, "Transaction");
+    parse(r);
+}
+
+// Validates the layout first, then parses the same bytes without checks
+Transaction::Transaction(std::span<const uint8_t> raw, size_t &off)
+{
+    TxByteRanges ranges = scan_transaction(raw, off);
+
+    ByteReader<UncheckedBounds> r(raw, off, "Transaction");
+    parse(r);
+    off = ranges.end;
+}
+
+template <typename Bounds>
+void Transaction::parse(ByteReader<Bounds> &r)
+{
+    std::span<const uint8_t> raw = r.data();
+
+    TxByteRanges ranges;
+    ranges.start = r.offset();
+
     // Parse 4-byte version field (little-endian)
-    version = read_uint32_le(raw, offset);
-    offset += 4;
+    version = r.u32("version");
 
     // SegWit detection: marker byte 0x00 followed by flag byte 0x01
     // BIP 141 (https://github.com/bitcoin/bips/blob/master/bip-0141.mediawiki)
-    if (offset + 1 < raw.size() && raw[offset] == 0x00 && raw[offset + 1] == 0x01)
-    {
-        isSegwit = true;
-        offset += 2;
-    }
-    else
-    {
-        isSegwit = false;
-    }
+    isSegwit = r.peek_equals(0x00, 0x01);
+    if (isSegwit)
+        r.skip(2);
+
+    ranges.segwit = isSegwit;
+    ranges.body_start = r.offset();
 
     // Parse inputs
-    uint64_t input_count = read_varint(raw, offset);
+    uint64_t input_count = r.varint("input count");
+    inputs.reserve(std::min<uint64_t>(input_count, r.remaining() / MIN_INPUT_SIZE));
 
     for (uint64_t i = 0; i < input_count; i++)
     {
         TxIn in{};
 
-        // Previous transaction ID: 32 bytes
-        if (offset + 32 > raw.size())
-            throw std::runtime_error("Transaction: truncated prevTxId");
-
-        for (int j = 0; j < 32; j++)
-            in.prevTxId[j] = raw[offset++];
-
-        // Output index of the previous transaction being spent
-        if (offset + 4 > raw.size())
-            throw std::runtime_error("Transaction: truncated vout");
-
-        in.vout = read_uint32_le(raw, offset);
-        offset += 4;
+        // Previous transaction ID and the index of the output being spent
+        in.prevTxId = r.template array<32>("prevTxId");
+        in.vout = r.u32("vout");
 
         // scriptSig: unlocking script for this input
-        uint64_t script_len = read_varint(raw, offset);
-
-        if (offset + script_len > raw.size())
-            throw std::runtime_error("Transaction: truncated scriptSig");
-
-        in.scriptSig.insert(in.scriptSig.end(),
-                            raw.begin() + offset,
-                            raw.begin() + offset + script_len);
-        offset += script_len;
+        std::span<const uint8_t> script = r.bytes(r.varint("scriptSig"), "scriptSig");
+        in.scriptSig.assign(script.begin(), script.end());
 
         // Sequence number; used for RBF and relative locktime (BIP 68 / BIP 125)
-        if (offset + 4 > raw.size())
-            throw std::runtime_error("Transaction: truncated sequence");
-
-        in.sequence = read_uint32_le(raw, offset);
-        offset += 4;
+        in.sequence = r.u32("sequence");
 
-        inputs.push_back(in);
+        inputs.push_back(std::move(in));
     }
 
     // Parse outputs
-    uint64_t output_count = read_varint(raw, offset);
+    uint64_t output_count = r.varint("output count");
+    outputs.reserve(std::min<uint64_t>(output_count, r.remaining() / MIN_OUTPUT_SIZE));
 
     for (uint64_t i = 0; i < output_count; i++)
     {
         TxOut out{};
 
         // Amount in satoshis (1 satoshi = 0.00000001 BTC)
-        if (offset + 8 > raw.size())
-            throw std::runtime_error("Transaction: truncated amount");
-
-        out.amount = read_uint64_le(raw, offset);
-        offset += 8;
+        out.amount = r.u64("amount");
 
         // scriptPubKey: locking script for this output
-        uint64_t script_len = read_varint(raw, offset);
-
-        if (offset + script_len > raw.size())
-            throw std::runtime_error("Transaction: truncated scriptPubKey");
-
-        out.scriptPubKey.insert(out.scriptPubKey.end(),
-                                raw.begin() + offset,
-                                raw.begin() + offset + script_len);
-        offset += script_len;
+        std::span<const uint8_t> script = r.bytes(r.varint("scriptPubKey"), "scriptPubKey");
+        out.scriptPubKey.assign(script.begin(), script.end());
 
-        outputs.push_back(out);
+        outputs.push_back(std::move(out));
     }
 
+    ranges.body_end = r.offset();
+
     // Parse witness data (only present in SegWit transactions)
-    // Each input has its own witness stack: a list of byte vectors
+    // Each input has its own witness stack: a list of byte strings
     if (isSegwit)
     {
+        size_t witness_start = r.offset();
+
         for (auto &in : inputs)
         {
-            uint64_t item_count = read_varint(raw, offset);
+            uint64_t item_count = r.varint("witness");
+            size_t first = witnessItems.size();
 
             for (uint64_t i = 0; i < item_count; i++)
-            {
-                uint64_t item_len = read_varint(raw, offset);
+                witnessItems.push_back(r.bytes(r.varint("witness item"), "witness item"));
+
+            // Only the count is final here, witnessItems may still move
+            in.witness = WitnessView(witnessItems).subspan(first);
+        }
 
-                if (offset + item_len > raw.size())
-                    throw std::runtime_error("Transaction: truncated witness item");
+        // One copy of the whole section, then rebase the item views from
+        // raw onto it and hand every input its slice
+        witnessData.assign(raw.begin() + witness_start, raw.begin() + r.offset());
 
-                std::vector<uint8_t> item(raw.begin() + offset,
-                                          raw.begin() + offset + item_len);
-                offset += item_len;
+        const uint8_t *section = raw.data() + witness_start;
+        for (auto &item : witnessItems)
+            item = std::span<const uint8_t>(witnessData.data() + (item.data() - section), item.size());
 
-                in.witness.push_back(item);
-            }
+        size_t first = 0;
+        for (auto &in : inputs)
+        {
+            size_t count = in.witness.size();
+            in.witness = WitnessView(witnessItems).subspan(first, count);
+            first += count;
         }
     }
 
     // 4-byte locktime field
-    if (offset + 4 > raw.size())
-        throw std::runtime_error("Transaction: truncated locktime");
+    locktime = r.u32("locktime");
+    ranges.end = r.offset();
 
-    locktime = read_uint32_le(raw, offset);
-    offset += 4;
+    // Precompute and cache both hashes once at construction time,
+    // straight from the parsed bytes
+    TxIdHash = ranges.txid(raw);
+    WTxIdHash = isSegwit ? ranges.wtxid(raw) : TxIdHash;
 
-    // Precompute and cache both hashes once at construction time
-    TxIdHash = reverse_32(double_sha256(serialize_legacy()));
-    WTxIdHash = isSegwit
-                    ? reverse_32(double_sha256(serialize_with_witness()))
-                    : TxIdHash;
+    sizeBytes = ranges.total_size();
+    witnessBytes = sizeBytes - ranges.base_size();
 }
 
-Transaction::Transaction(const std::vector<uint8_t> &raw, size_t &off)
+TxByteRanges scan_transaction(std::span<const uint8_t> raw, size_t off)
 {
-    version = read_uint32_le(raw, off);
-    off += 4;
+    ByteReader<CheckedBounds> r(raw, off, "Transaction");
 
-    if (off + 1 < raw.size() && raw[off] == 0x00 && raw[off + 1] == 0x01)
-    {
-        isSegwit = true;
-        off += 2;
-    }
-    else
-    {
-        isSegwit = false;
-    }
+    TxByteRanges ranges;
+    ranges.start = off;
+
+    r.skip(4, "version");
 
-    uint64_t input_count = read_varint(raw, off);
+    ranges.segwit = r.peek_equals(0x00, 0x01);
+    if (ranges.segwit)
+        r.skip(2);
+
+    ranges.body_start = r.offset();
+
+    uint64_t input_count = r.varint("input count");
     for (uint64_t i = 0; i < input_count; i++)
     {
-        TxIn in{};
-        if (off + 32 > raw.size())
-            throw std::runtime_error("Transaction: truncated prevTxId");
-        for (int j = 0; j < 32; j++)
-            in.prevTxId[j] = raw[off++];
-        in.vout = read_uint32_le(raw, off);
-        off += 4;
-        uint64_t script_len = read_varint(raw, off);
-        in.scriptSig.insert(in.scriptSig.end(),
-                            raw.begin() + off, raw.begin() + off + script_len);
-        off += script_len;
-        in.sequence = read_uint32_le(raw, off);
-        off += 4;
-        inputs.push_back(in);
+        r.skip(32, "prevTxId");
+        r.skip(4, "vout");
+        r.skip(r.varint("scriptSig"), "scriptSig");
+        r.skip(4, "sequence");
     }
 
-    uint64_t output_count = read_varint(raw, off);
+    uint64_t output_count = r.varint("output count");
     for (uint64_t i = 0; i < output_count; i++)
     {
-        TxOut out{};
-        out.amount = read_uint64_le(raw, off);
-        off += 8;
-        uint64_t script_len = read_varint(raw, off);
-        out.scriptPubKey.insert(out.scriptPubKey.end(),
-                                raw.begin() + off, raw.begin() + off + script_len);
-        off += script_len;
-        outputs.push_back(out);
+        r.skip(8, "amount");
+        r.skip(r.varint("scriptPubKey"), "scriptPubKey");
     }
 
-    if (isSegwit)
+    ranges.body_end = r.offset();
+
+    if (ranges.segwit)
     {
-        for (auto &in : inputs)
+        for (uint64_t i = 0; i < input_count; i++)
         {
-            uint64_t item_count = read_varint(raw, off);
-            for (uint64_t i = 0; i < item_count; i++)
-            {
-                uint64_t item_len = read_varint(raw, off);
-                if (off + item_len > raw.size())
-                    throw std::runtime_error("Transaction: truncated witness item");
-                std::vector<uint8_t> item(raw.begin() + off,
-                                          raw.begin() + off + item_len);
-                off += item_len;
-                in.witness.push_back(item);
-            }
+            uint64_t item_count = r.varint("witness");
+            for (uint64_t j = 0; j < item_count; j++)
+                r.skip(r.varint("witness item"), "witness item");
         }
     }
 
-    locktime = read_uint32_le(raw, off);
-    off += 4;
+    r.skip(4, "locktime");
+    ranges.end = r.offset();
 
-    TxIdHash = reverse_32(double_sha256(serialize_legacy()));
-    WTxIdHash = isSegwit
-                    ? reverse_32(double_sha256(serialize_with_witness()))
-                    : TxIdHash;
+    return ranges;
 }
 
 // SegWit Getter
@@ -265,22 +256,19 @@ bool Transaction::is_segwit() const
 
 // Size / Weight
 
-// Calculate and return size of transaction in bytes
+// Size of the transaction in bytes, witness data included
 size_t Transaction::get_size_bytes() const
 {
-    return serialize_with_witness().size();
+    return sizeBytes;
 }
 
-// Calculate and return weight of transaction
+// Weight of the transaction
 // Follows BIP 141: weight = base_size * 4 + witness_size
 // (https://github.com/bitcoin/bips/blob/master/bip-0141.mediawiki#transaction-size-calculations)
 size_t Transaction::get_weight() const
 {
-    size_t base = serialize_legacy().size();
-    size_t total = serialize_with_witness().size();
-    size_t witness = total - base;
-
-    return base * 4 + witness;
+    size_t base = sizeBytes - witnessBytes;
+    return base * 4 + witnessBytes;
 }
 
 // Calculate and return virtual bytes (vbytes) of transaction
@@ -298,6 +286,11 @@ size_t Transaction::get_vbytes() const
 //   BLOCK_HEIGHT   - locktime < 500,000,000 (treated as a block number)
 //   UNIX_TIMESTAMP - locktime >= 500,000,000 (treated as a Unix timestamp)
 LockTimeType Transaction::get_locktime_type() const
+{
+    return locktime_type_of(locktime);
+}
+
+LockTimeType locktime_type_of(uint32_t locktime)
 {
     if (locktime == 0)
         return LockTimeType::NONE;
@@ -345,103 +338,27 @@ bool Transaction::RBF_enabled() const
     return false;
 }
 
-// Serialization (private)
+// TXID & WTXID
 
-// Serialize the transaction to bytes without witness data
-// Used internally to compute TxIdHash
-std::vector<uint8_t> Transaction::serialize_legacy() const
+// The txid skips marker, flag and witness simply by not hashing their
+// bytes: version, then everything from the input count to the last output,
+// then locktime
+std::array<uint8_t, 32> TxByteRanges::txid(std::span<const uint8_t> raw) const
 {
-    std::vector<uint8_t> out;
-
-    write_uint32_le(out, version);
-
-    write_varint(out, inputs.size());
-
-    for (const auto &in : inputs)
-    {
-        out.insert(out.end(), in.prevTxId.begin(), in.prevTxId.end());
-        write_uint32_le(out, in.vout);
-
-        write_varint(out, in.scriptSig.size());
-        out.insert(out.end(), in.scriptSig.begin(), in.scriptSig.end());
-
-        write_uint32_le(out, in.sequence);
-    }
-
-    write_varint(out, outputs.size());
-
-    for (const auto &o : outputs)
-    {
-        write_uint64_le(out, o.amount);
-
-        write_varint(out, o.scriptPubKey.size());
-        out.insert(out.end(), o.scriptPubKey.begin(), o.scriptPubKey.end());
-    }
-
-    write_uint32_le(out, locktime);
-
-    return out;
+    return reverse_32(Sha256Hasher()
+                          .write(raw.subspan(start, 4))
+                          .write(raw.subspan(body_start, body_end - body_start))
+                          .write(raw.subspan(end - 4, 4))
+                          .finalize_double());
 }
 
-// Serialize the transaction to bytes with witness data
-// Used internally to compute WTxIdHash
-// For non-segwit transactions falls back to serialize_legacy()
-std::vector<uint8_t> Transaction::serialize_with_witness() const
+std::array<uint8_t, 32> TxByteRanges::wtxid(std::span<const uint8_t> raw) const
 {
-    if (!isSegwit)
-        return serialize_legacy();
-
-    std::vector<uint8_t> out;
-
-    write_uint32_le(out, version);
-
-    // SegWit marker (0x00) and flag (0x01)
-    out.push_back(0x00);
-    out.push_back(0x01);
-
-    write_varint(out, inputs.size());
-
-    for (const auto &in : inputs)
-    {
-        out.insert(out.end(), in.prevTxId.begin(), in.prevTxId.end());
-        write_uint32_le(out, in.vout);
-
-        write_varint(out, in.scriptSig.size());
-        out.insert(out.end(), in.scriptSig.begin(), in.scriptSig.end());
-
-        write_uint32_le(out, in.sequence);
-    }
-
-    write_varint(out, outputs.size());
-
-    for (const auto &o : outputs)
-    {
-        write_uint64_le(out, o.amount);
-
-        write_varint(out, o.scriptPubKey.size());
-        out.insert(out.end(), o.scriptPubKey.begin(), o.scriptPubKey.end());
-    }
-
-    // Witness data: one witness stack per input
-    // Each stack: item_count (varint), then per item: length (varint) + bytes
-    for (const auto &in : inputs)
-    {
-        write_varint(out, in.witness.size());
-
-        for (const auto &item : in.witness)
-        {
-            write_varint(out, item.size());
-            out.insert(out.end(), item.begin(), item.end());
-        }
-    }
-
-    write_uint32_le(out, locktime);
-
-    return out;
+    if (!segwit)
+        return txid(raw);
+    return reverse_32(Sha256Hasher().write(raw.subspan(start, end - start)).finalize_double());
 }
 
-// TXID & WTXID
-
 // Returns the precomputed TxID
 // TxID = double-SHA256 of legacy serialization, reversed (big-endian display format)
 std::array<uint8_t, 32> Transaction::get_txid() const
@@ -3,10 +3,15 @@
 
 #include <vector>
 #include <array>
+#include <span>
 #include <cstdint>
 #include <string>
 #include <stdexcept>
 #include "utilities.h"
+#include "small_script.h"
+
+template <typename Bounds>
+class ByteReader;
 
 enum class LockTimeType {
 	UNIX_TIMESTAMP,
@@ -29,16 +34,52 @@ struct RelativeLocktimeInfo {
 	uint16_t value;
 };
 
+// Where the parts of one serialized transaction lie in the parsed bytes,
+// recorded by the parser so the hashes need no re-serialization
+struct TxByteRanges {
+	size_t start = 0;      // version
+	size_t body_start = 0; // input count, past marker/flag if present
+	size_t body_end = 0;   // past the last output (= start of the witness)
+	size_t end = 0;        // past locktime
+	bool segwit = false;
+
+	// HASH256 of version || inputs/outputs || locktime, reversed for display
+	std::array<uint8_t, 32> txid(std::span<const uint8_t> raw) const;
+
+	// HASH256 of the whole range, reversed; equal to txid() if not segwit
+	std::array<uint8_t, 32> wtxid(std::span<const uint8_t> raw) const;
+
+	// Serialized size with witness data
+	size_t total_size() const { return end - start; }
+
+	// Serialized size without marker, flag and witness (BIP 141 base size)
+	size_t base_size() const { return 4 + (body_end - body_start) + 4; }
+};
+
+// Walks the transaction starting at off with bounds checks on every field
+// and returns its byte ranges, nothing is copied or kept. Throws
+// "Transaction: truncated <field>" on short data. Bytes that passed this can
+// be parsed with an unchecked ByteReader.
+TxByteRanges scan_transaction(std::span<const uint8_t> raw, size_t off);
+
+// Smallest serialized transaction (version, empty input and output counts,
+// locktime), bounds how many transactions a buffer can hold
+constexpr size_t MIN_TX_SIZE = 10;
+
+// Witness stack of one input, every item a view of its bytes
+using WitnessView = std::span<const std::span<const uint8_t>>;
+
 class TxIn {
 
 	public:
 		std::array<uint8_t, 32> prevTxId;
 		uint32_t vout;
-		std::vector<uint8_t> scriptSig;
+		Script scriptSig;
 		uint32_t sequence;
 
 		// only present if isSegwit is true
-		std::vector<std::vector<uint8_t>> witness;
+		// The items live in the owning Transaction's witness buffer
+		WitnessView witness;
 
 		// FXNS FOR sequence field
 		// these are specific to input
@@ -55,7 +96,7 @@ class TxOut {
 	public:
 		// Amount is in Satoshis, 1 Satoshis = 0.00000001 BTC
 		uint64_t amount;
-		std::vector<uint8_t> scriptPubKey;
+		Script scriptPubKey;
 };
 
 class Transaction {
@@ -74,20 +115,28 @@ class Transaction {
 		// constructor that build Txn using the raw transaction array of bytes 
 		Transaction(const std::vector<uint8_t>& raw_txn_hex_bytes);
 
-		// Constructor used by block
-		Transaction(const std::vector<uint8_t> &raw, size_t &off);
+		// Constructor used by block, parses in place starting at off
+		// raw can be a view straight into the (mapped) blk record
+		Transaction(std::span<const uint8_t> raw, size_t &off);
+
+		// The inputs' witness views point into witnessData, a copy would
+		// still point into the original's; a move keeps the buffers
+		Transaction(const Transaction &) = delete;
+		Transaction &operator=(const Transaction &) = delete;
+		Transaction(Transaction &&) = default;
+		Transaction &operator=(Transaction &&) = default;
 
 		// Getter for the private variable
 		bool is_segwit() const;
 
-		// calculate and return size of txn in bytes
+		// size of txn in bytes, as parsed
 		size_t get_size_bytes() const;
 
-		// calculate and return weight of txn
+		// weight of txn
 		// follows BIP 141 (https://github.com/bitcoin/bips/blob/master/bip-0141.mediawiki#transaction-size-calculations)
 		size_t get_weight() const;
 
-		// calculate and return vbytes of txn
+		// vbytes of txn
 		// follows BIP 141 (https://github.com/bitcoin/bips/blob/master/bip-0141.mediawiki#transaction-size-calculations)
 		size_t get_vbytes() const;
 
@@ -109,30 +158,45 @@ class Transaction {
 		// introduced in BIP 125 (https://github.com/bitcoin/bips/blob/master/bip-0125.mediawiki)
 		bool RBF_enabled() const;
 
-        // Returns the precomputed TxID (double-SHA256 of legacy serialization, reversed)
+        // Returns the precomputed TxID (double-SHA256 of the non-witness bytes, reversed)
         std::array<uint8_t, 32> get_txid() const;
 
-        // Returns the precomputed wTxID (double-SHA256 of witness serialization, reversed)
+        // Returns the precomputed wTxID (double-SHA256 of all bytes, reversed)
         // For non-segwit transactions wTxID == TxID per BIP 141
         std::array<uint8_t, 32> get_wtxid() const;
 
 	private:
+		// Shared by both constructors: checked when parsing untrusted
+		// bytes directly, unchecked after scan_transaction()
+		template <typename Bounds>
+		void parse(ByteReader<Bounds> &r);
+
 		bool isSegwit;
 
+		// Witness section of the serialization, copied out in one piece,
+		// and a view of every item in it (all inputs, in order). TxIn::witness
+		// is a slice of witnessItems, so a stack of many items costs no
+		// allocation per item.
+		std::vector<uint8_t> witnessData;
+		std::vector<std::span<const uint8_t>> witnessItems;
+
 		// Precomputed hash caches, calculated once in the constructor
         std::array<uint8_t, 32> TxIdHash;
         std::array<uint8_t, 32> WTxIdHash;
 
-        // Will serialize the Txn to bytes, no witness data
-        // used internally to compute TxIdHash
-        std::vector<uint8_t> serialize_legacy() const;
-
-        // Will serialize the Txn to bytes, with witness data
-        // used internally to compute WTxIdHash
-        std::vector<uint8_t> serialize_with_witness() const;
+        // Sizes taken from the parsed byte ranges, the getters above are O(1)
+        // sizeBytes includes witness data, witnessBytes includes marker and flag
+        size_t sizeBytes;
+        size_t witnessBytes;
 
 };
 
+// Relative locktime of an input with the given sequence, TxIn::get_rlt_info()
+RelativeLocktimeInfo rlt_info_from_sequence(uint32_t sequence);
+
+// Locktime type for a locktime value, Transaction::get_locktime_type()
+LockTimeType locktime_type_of(uint32_t locktime);
+
 // Helpers for enum to string conversion
 std::string locktime_type_str(LockTimeType t);
 
@@ -0,0 +1,148 @@
+#include "transaction_view.h"
+#include "byte_reader.h"
+
+
+// TxInView
+
+bool TxInView::RLT_enabled() const
+{
+    return !(sequence & (1u << 31));
+}
+
+RelativeLocktimeInfo TxInView::get_rlt_info() const
+{
+    return rlt_info_from_sequence(sequence);
+}
+
+// TransactionView
+
+TransactionView::TransactionView(std::span<const uint8_t> raw,
+                                 std::pmr::memory_resource *mr)
+    : outputs(mr), inputs(mr), witnessItems(mr)
+{
+    TxByteRanges ranges = scan_transaction(raw, 0);
+    if (ranges.end != raw.size())
+        throw std::runtime_error("Transaction: trailing bytes after locktime");
+
+    parse(raw, ranges);
+}
+
+TransactionView::TransactionView(std::span<const uint8_t> raw, size_t &off,
+                                 std::pmr::memory_resource *mr)
+    : outputs(mr), inputs(mr), witnessItems(mr)
+{
+    TxByteRanges ranges = scan_transaction(raw, off);
+    parse(raw, ranges);
+    off = ranges.end;
+}
+
+TransactionView::TransactionView(std::pmr::memory_resource *mr)
+    : version(0), outputs(mr), inputs(mr), locktime(0),
+      isSegwit(false), baseSize(0), witnessItems(mr), TxIdHash{}, WTxIdHash{}
+{
+}
+
+// ranges comes from scan_transaction(), which already checked every length,
+// so the reads below are unchecked and the counts can be reserved as is
+void TransactionView::parse(std::span<const uint8_t> raw, const TxByteRanges &ranges,
+                            const std::array<uint8_t, 32> *txid)
+{
+    ByteReader<UncheckedBounds> r(raw, ranges.start);
+
+    inputs.clear();
+    outputs.clear();
+    witnessItems.clear();
+
+    version = r.u32();
+
+    isSegwit = ranges.segwit;
+    if (isSegwit)
+        r.skip(2);
+
+    uint64_t input_count = r.varint();
+    inputs.reserve(input_count);
+
+    for (uint64_t i = 0; i < input_count; i++)
+    {
+        TxInView in{};
+        in.prevTxId = r.array<32>();
+        in.vout = r.u32();
+        in.scriptSig = r.bytes(r.varint());
+        in.sequence = r.u32();
+        inputs.push_back(in);
+    }
+
+    uint64_t output_count = r.varint();
+    outputs.reserve(output_count);
+
+    for (uint64_t i = 0; i < output_count; i++)
+    {
+        TxOutView out{};
+        out.amount = r.u64();
+        out.scriptPubKey = r.bytes(r.varint());
+        outputs.push_back(out);
+    }
+
+    if (isSegwit)
+    {
+        for (auto &in : inputs)
+        {
+            uint64_t item_count = r.varint();
+            size_t first = witnessItems.size();
+
+            for (uint64_t i = 0; i < item_count; i++)
+                witnessItems.push_back(r.bytes(r.varint()));
+
+            // Only the count is final here, witnessItems may still move
+            in.witness = WitnessView(witnessItems).subspan(first);
+        }
+
+        size_t first = 0;
+        for (auto &in : inputs)
+        {
+            size_t count = in.witness.size();
+            in.witness = WitnessView(witnessItems).subspan(first, count);
+            first += count;
+        }
+    }
+
+    locktime = r.u32();
+
+    rawBytes = raw.subspan(ranges.start, ranges.total_size());
+    baseSize = ranges.base_size();
+
+    TxIdHash = txid ? *txid : ranges.txid(raw);
+    WTxIdHash = isSegwit ? ranges.wtxid(raw) : TxIdHash;
+}
+
+size_t TransactionView::get_size_bytes() const
+{
+    return rawBytes.size();
+}
+
+// BIP 141: weight = base_size * 4 + witness_size, where the witness part
+// includes marker and flag
+size_t TransactionView::get_weight() const
+{
+    return baseSize * 4 + (rawBytes.size() - baseSize);
+}
+
+size_t TransactionView::get_vbytes() const
+{
+    return (get_weight() + 3) / 4;
+}
+
+LockTimeType TransactionView::get_locktime_type() const
+{
+    return locktime_type_of(locktime);
+}
+
+// BIP 125: at least one input with sequence < 0xFFFFFFFE
+bool TransactionView::RBF_enabled() const
+{
+    for (const auto &in : inputs)
+        if (in.sequence < 0xFFFFFFFE)
+            return true;
+
+    return false;
+}
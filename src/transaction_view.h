@@ -0,0 +1,112 @@
+#ifndef TRANSACTION_VIEW_H
+#define TRANSACTION_VIEW_H
+
+#include "transaction.h"
+#include <vector>
+#include <memory_resource>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+// Read only counterparts of TxIn / TxOut / Transaction that keep scripts and
+// witness items as views into the bytes they were parsed from instead of
+// copying them out. Field and getter names match the owning types so code
+// can work on either. The parsed bytes (e.g. a mapped blk record) must
+// outlive the view.
+
+class TxInView
+{
+public:
+    std::array<uint8_t, 32> prevTxId;
+    uint32_t vout;
+    std::span<const uint8_t> scriptSig;
+    uint32_t sequence;
+
+    // empty unless the transaction is segwit
+    WitnessView witness;
+
+    // Same as TxIn
+    bool RLT_enabled() const;
+    RelativeLocktimeInfo get_rlt_info() const;
+};
+
+class TxOutView
+{
+public:
+    uint64_t amount;
+    std::span<const uint8_t> scriptPubKey;
+};
+
+class TransactionView
+{
+public:
+    uint32_t version;
+
+    std::pmr::vector<TxOutView> outputs;
+    std::pmr::vector<TxInView> inputs;
+
+    uint32_t locktime;
+
+    // Parses one transaction starting at off, leaves off just past it
+    // The input/output/witness tables are allocated from mr
+    TransactionView(std::span<const uint8_t> raw, size_t &off,
+                    std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // raw holds exactly one transaction
+    explicit TransactionView(std::span<const uint8_t> raw,
+                             std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // Empty view whose tables use mr, filled by parse()
+    explicit TransactionView(std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    // The inputs' witness views point into witnessItems, a copy would
+    // still point into the original's. Moving keeps the tables (and their
+    // memory resource); move assignment is left out because between two
+    // resources it would copy them instead
+    TransactionView(const TransactionView &) = delete;
+    TransactionView &operator=(const TransactionView &) = delete;
+    TransactionView(TransactionView &&) = default;
+    TransactionView &operator=(TransactionView &&) = delete;
+
+    bool is_segwit() const { return isSegwit; }
+
+    // The serialized transaction as it was parsed
+    std::span<const uint8_t> raw() const { return rawBytes; }
+
+    // Sizes come from the parsed byte ranges, nothing is re-serialized
+    size_t get_size_bytes() const;
+    size_t get_weight() const;
+    size_t get_vbytes() const;
+
+    LockTimeType get_locktime_type() const;
+    bool RBF_enabled() const;
+
+    // Display order, same as Transaction
+    std::array<uint8_t, 32> get_txid() const { return TxIdHash; }
+    std::array<uint8_t, 32> get_wtxid() const { return WTxIdHash; }
+
+    // Replaces the contents with the transaction at ranges, which must come
+    // from scan_transaction() over raw: nothing is bounds checked here.
+    // Lets a block find all its transactions first and parse them later,
+    // possibly on several threads. txid: the display order txid if the
+    // caller already hashed it, so it is not hashed again.
+    void parse(std::span<const uint8_t> raw, const TxByteRanges &ranges,
+               const std::array<uint8_t, 32> *txid = nullptr);
+
+private:
+    bool isSegwit;
+
+    std::span<const uint8_t> rawBytes;
+
+    // serialized size without marker, flag and witness data
+    size_t baseSize;
+
+    // every witness item of every input, in order
+    std::pmr::vector<std::span<const uint8_t>> witnessItems;
+
+    std::array<uint8_t, 32> TxIdHash;
+    std::array<uint8_t, 32> WTxIdHash;
+};
+
+#endif
@@ -1,4 +1,11 @@
 #include "utilities.h"
+#include "byte_reader.h"
+#include <cctype>
+#include <filesystem>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 // Helper fxn to convert a hex char to its decimal value
 static uint8_t hex_char_to_int_val(char c)
@@ -30,8 +37,8 @@ std::vector<uint8_t> hex_to_bytes(const std::string& hex)
     return bytes;
 }
 
-// Takes a byte vector as input and returns the equivalent hex string
-std::string bytes_to_hex(const std::vector<uint8_t>& bytes)
+// Takes a byte vector (or a view of bytes) as input and returns the equivalent hex string
+std::string bytes_to_hex(std::span<const uint8_t> bytes)
 {
     const char* hex_chars = "0123456789abcdef";
     std::string result;
@@ -46,6 +53,21 @@ std::string bytes_to_hex(const std::vector<uint8_t>& bytes)
     return result;
 }
 
+// Same, the string is allocated from mr
+std::pmr::string bytes_to_hex(std::span<const uint8_t> bytes, std::pmr::memory_resource* mr)
+{
+    const char* hex_chars = "0123456789abcdef";
+    std::pmr::string result(bytes.size() * 2, '\0', mr);
+
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        result[2 * i]     = hex_chars[bytes[i] >> 4];
+        result[2 * i + 1] = hex_chars[bytes[i] & 0x0F];
+    }
+
+    return result;
+}
+
 
 // Takes in a 32 bytes array and converts it to it's equivalent string rep.
 std::string bytes_to_hex(const std::array<uint8_t, 32>& bytes)
@@ -65,30 +87,22 @@ std::string bytes_to_hex(const std::array<uint8_t, 32>& bytes)
 
 // Reads 32 bit int from a data starting from a given offset value
 // expects the data is in LE format
-uint32_t read_uint32_le(const std::vector<uint8_t>& data, size_t offset)
+uint32_t read_uint32_le(std::span<const uint8_t> data, size_t offset)
 {
     if (offset + 4 > data.size())
         throw std::out_of_range("read_uint32_le: not enough bytes");
 
-    uint32_t value = 0;
-    for (size_t i = 0; i < 4; i++)
-        value |= static_cast<uint32_t>(data[offset + i]) << (i * 8);
-
-    return value;
+    return load_le32(data.data() + offset);
 }
 
 // Reads 64 bit int from a data starting from a given offset value
 // expects the data is in LE format
-uint64_t read_uint64_le(const std::vector<uint8_t>& data, size_t offset)
+uint64_t read_uint64_le(std::span<const uint8_t> data, size_t offset)
 {
     if (offset + 8 > data.size())
         throw std::out_of_range("read_uint64_le: not enough bytes");
 
-    uint64_t value = 0;
-    for (size_t i = 0; i < 8; i++)
-        value |= static_cast<uint64_t>(data[offset + i]) << (i * 8);
-
-    return value;
+    return load_le64(data.data() + offset);
 }
 
 // Writes a 32bit value in LE format in the given buffer
@@ -115,18 +129,17 @@ void write_uint64_le(std::vector<uint8_t>& buffer, uint64_t value)
 
 
 // HELPER , like the above fxns read a 16 bit int after a offset in given data
-uint16_t read_uint16_le(const std::vector<uint8_t>& data, size_t offset)
+uint16_t read_uint16_le(std::span<const uint8_t> data, size_t offset)
 {
     if (offset + 2 > data.size())
         throw std::out_of_range("read_uint16_le: not enough bytes");
 
-    return  static_cast<uint16_t>(data[offset]) |
-           (static_cast<uint16_t>(data[offset + 1]) << 8);
+    return load_le16(data.data() + offset);
 }
 
 
 // Reads a variable integer / CompactSize in data after a given offset
-uint64_t read_varint(const std::vector<uint8_t>& data, size_t& offset)
+uint64_t read_varint(std::span<const uint8_t> data, size_t& offset)
 {
     if (offset >= data.size())
         throw std::out_of_range("read_varint: no data");
@@ -191,11 +204,21 @@ void write_varint(std::vector<uint8_t>& buffer, uint64_t value)
 // HASHING
 // Uses the OpenSSL libarary implementations
 
+// One shot SHA256 through the low level API, which unlike SHA256() and the
+// EVP interface does not allocate
+static void sha256_into(const uint8_t* data, size_t len, uint8_t* out)
+{
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, data, len);
+    SHA256_Final(out, &ctx);
+}
+
 // returns the sha256 digest
 std::array<uint8_t, 32> sha256(const std::vector<uint8_t>& data)
 {
     std::array<uint8_t, 32> hash;
-    SHA256(data.data(), data.size(), hash.data());
+    sha256_into(data.data(), data.size(), hash.data());
     return hash;
 }
 
@@ -208,6 +231,34 @@ std::array<uint8_t, 32> double_sha256(const std::vector<uint8_t>& data)
 }
 
 
+Sha256Hasher::Sha256Hasher()
+{
+    SHA256_Init(&ctx_);
+}
+
+Sha256Hasher& Sha256Hasher::write(std::span<const uint8_t> data)
+{
+    if (!data.empty())
+        SHA256_Update(&ctx_, data.data(), data.size());
+    return *this;
+}
+
+std::array<uint8_t, 32> Sha256Hasher::finalize()
+{
+    std::array<uint8_t, 32> hash;
+    SHA256_Final(hash.data(), &ctx_);
+    return hash;
+}
+
+std::array<uint8_t, 32> Sha256Hasher::finalize_double()
+{
+    std::array<uint8_t, 32> first_pass = finalize();
+    std::array<uint8_t, 32> hash;
+    sha256_into(first_pass.data(), first_pass.size(), hash.data());
+    return hash;
+}
+
+
 // HANDY helper to reverse a 32 bye array
 std::array<uint8_t, 32> reverse_32(const std::array<uint8_t, 32>& data)
 {
@@ -405,9 +456,103 @@ std::vector<uint8_t> read_xor_key(const std::string& xor_dat_path)
     return all_zero ? std::vector<uint8_t>{} : raw;
 }
 
+std::string blocks_dir_xor_path(const std::string& blocks_dir)
+{
+    std::filesystem::path xor_path = std::filesystem::path(blocks_dir) / "xor.dat";
+    return std::filesystem::exists(xor_path) ? xor_path.string() : "";
+}
+
+std::vector<uint8_t> read_blocks_dir_xor_key(const std::string& blocks_dir)
+{
+    std::string xor_path = blocks_dir_xor_path(blocks_dir);
+    return xor_path.empty() ? std::vector<uint8_t>{} : read_xor_key(xor_path);
+}
+
+std::optional<unsigned> dat_file_number(const std::string& name, std::string_view prefix)
+{
+    constexpr size_t DIGITS = 5;
+    std::string_view s(name);
+    if (s.size() != prefix.size() + DIGITS + 4 ||
+        !s.starts_with(prefix) || !s.ends_with(".dat"))
+        return std::nullopt;
+
+    unsigned num = 0;
+    for (char c : s.substr(prefix.size(), DIGITS))
+    {
+        if (!std::isdigit(static_cast<unsigned char>(c)))
+            return std::nullopt;
+        num = num * 10 + static_cast<unsigned>(c - '0');
+    }
+    return num;
+}
+
 void xor_decode(std::vector<uint8_t>& data, const std::vector<uint8_t>& key)
+{
+    xor_decode(std::span<uint8_t>(data), key, 0);
+}
+
+// Keystream width, one AVX2 register / two SSE2 registers / four words
+static constexpr size_t XOR_LANE = 32;
+
+void xor_decode(std::span<uint8_t> data, const std::vector<uint8_t>& key,
+                uint64_t file_offset)
 {
     if (key.empty()) return;
-    for (size_t i = 0; i < data.size(); ++i)
-        data[i] ^= key[i % key.size()];
+
+    uint8_t* p = data.data();
+    size_t n = data.size();
+    size_t k = key.size();
+
+    // The wide path needs the key to tile the lane exactly (xor.dat is 8 bytes)
+    if (XOR_LANE % k != 0 || n < XOR_LANE)
+    {
+        for (size_t i = 0; i < n; ++i)
+            p[i] ^= key[(file_offset + i) % k];
+        return;
+    }
+
+    // Expand the key into a lane wide keystream that already starts at the
+    // right key byte for file_offset, then every lane uses the same stream
+    alignas(32) uint8_t ks[XOR_LANE];
+    size_t phase = file_offset % k;
+    for (size_t i = 0; i < XOR_LANE; ++i)
+        ks[i] = key[(phase + i) % k];
+
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i ks256 = _mm256_load_si256(reinterpret_cast<const __m256i*>(ks));
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_xor_si256(v, ks256));
+    }
+#elif defined(__SSE2__)
+    const __m128i ks_lo = _mm_load_si128(reinterpret_cast<const __m128i*>(ks));
+    const __m128i ks_hi = _mm_load_si128(reinterpret_cast<const __m128i*>(ks + 16));
+    for (; i + 32 <= n; i += 32)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(a, ks_lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i + 16), _mm_xor_si128(b, ks_hi));
+    }
+#else
+    uint64_t ks64[XOR_LANE / 8];
+    std::memcpy(ks64, ks, XOR_LANE);
+    for (; i + XOR_LANE <= n; i += XOR_LANE)
+    {
+        for (size_t w = 0; w < XOR_LANE / 8; ++w)
+        {
+            uint64_t v;
+            std::memcpy(&v, p + i + w * 8, 8);
+            v ^= ks64[w];
+            std::memcpy(p + i + w * 8, &v, 8);
+        }
+    }
+#endif
+
+    // Tail, i is a multiple of the lane so the keystream is still in phase
+    for (size_t j = 0; i < n; ++i, ++j)
+        p[i] ^= ks[j];
 }
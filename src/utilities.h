@@ -3,11 +3,16 @@
 
 #include <vector>
 #include <array>
+#include <span>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <optional>
 #include <stdexcept>
 #include <fstream>
 #include <algorithm>
 #include <openssl/sha.h>
+#include <openssl/evp.h>
 #include <openssl/ripemd.h>
 #include <cstring>
 #include <secp256k1.h>
@@ -19,8 +24,11 @@ extern "C" {
 // Takes a hex string as input and returns a byte vector
 std::vector<uint8_t> hex_to_bytes(const std::string& hex);
 
-// Takes a byte vector as input and returns the equivalent hex string
-std::string bytes_to_hex(const std::vector<uint8_t>& bytes);
+// Takes a byte vector (or a view of bytes) as input and returns the equivalent hex string
+std::string bytes_to_hex(std::span<const uint8_t> bytes);
+
+// Same, the string is allocated from mr
+std::pmr::string bytes_to_hex(std::span<const uint8_t> bytes, std::pmr::memory_resource* mr);
 
 // Takes in a 32 bytes array and converts it to it's equivalent string rep.
 std::string bytes_to_hex(const std::array<uint8_t, 32>& bytes);
@@ -28,11 +36,11 @@ std::string bytes_to_hex(const std::array<uint8_t, 32>& bytes);
 
 // Reads 32 bit int from a data starting from a given offset value
 // expects the data is in LE format
-uint32_t read_uint32_le(const std::vector<uint8_t>& data, size_t offset);
+uint32_t read_uint32_le(std::span<const uint8_t> data, size_t offset);
 
 // Reads 64 bit int from a data starting from a given offset value
 // expects the data is in LE format
-uint64_t read_uint64_le(const std::vector<uint8_t>& data, size_t offset);
+uint64_t read_uint64_le(std::span<const uint8_t> data, size_t offset);
 
 // Writes a 32bit value in LE format in the given buffer
 void write_uint32_le(std::vector<uint8_t>& buffer, uint32_t value);
@@ -41,7 +49,7 @@ void write_uint32_le(std::vector<uint8_t>& buffer, uint32_t value);
 void write_uint64_le(std::vector<uint8_t>& buffer, uint64_t value);
 
 // HELPER , like the above fxns read a 16 bit int after a offset in given data
-uint16_t read_uint16_le(const std::vector<uint8_t>& data, size_t offset);
+uint16_t read_uint16_le(std::span<const uint8_t> data, size_t offset);
 
 // VarInt (CompactSize) helpers
 // reference: https://en.bitcoin.it/wiki/Protocol_documentation#Variable_length_integer
@@ -52,7 +60,7 @@ uint16_t read_uint16_le(const std::vector<uint8_t>& data, size_t offset);
 //   0xFF + 8 LE   -> up to 0xFFFFFFFFFFFFFFFF
 
 // Reads a variable integer / CompactSize in data after a given offset
-uint64_t read_varint(const std::vector<uint8_t>& data, size_t& offset);
+uint64_t read_varint(std::span<const uint8_t> data, size_t& offset);
 
 // Writes a variable integer / CompactSize value in a given buffer
 void write_varint(std::vector<uint8_t>& buffer, uint64_t value);
@@ -68,6 +76,31 @@ std::array<uint8_t, 32> sha256(const std::vector<uint8_t>& data);
 std::array<uint8_t, 32> double_sha256(const std::vector<uint8_t>& data);
 
 
+// Incremental SHA256 over several byte ranges, avoids gluing them into one
+// buffer first. Feed ranges with write(), then call one of the finalizers once.
+// The context lives in the hasher itself: EVP contexts allocate on every
+// init under OpenSSL 3, and this runs per transaction.
+class Sha256Hasher
+{
+public:
+    Sha256Hasher();
+
+    Sha256Hasher(const Sha256Hasher&) = delete;
+    Sha256Hasher& operator=(const Sha256Hasher&) = delete;
+
+    Sha256Hasher& write(std::span<const uint8_t> data);
+
+    // sha256 of everything written
+    std::array<uint8_t, 32> finalize();
+
+    // double sha256 (HASH256) of everything written
+    std::array<uint8_t, 32> finalize_double();
+
+private:
+    SHA256_CTX ctx_;
+};
+
+
 // HANDY helper to reverse a 32 bye array
 std::array<uint8_t, 32> reverse_32(const std::array<uint8_t, 32>& data);
 
@@ -97,9 +130,26 @@ std::vector<uint8_t> read_file(const std::string& path);
 // Reads XOR key from xor.dat (returns empty if all-zero)
 std::vector<uint8_t> read_xor_key(const std::string& xor_dat_path);
 
+// xor.dat of a blocks directory, "" if there is none: nodes started before
+// v28 have no xor.dat, their files are not obfuscated
+std::string blocks_dir_xor_path(const std::string& blocks_dir);
+
+// Key from the blocks directory's xor.dat, empty if there is none
+std::vector<uint8_t> read_blocks_dir_xor_key(const std::string& blocks_dir);
+
+// Number of a data file name: "blk00123.dat" with prefix "blk" -> 123.
+// Exactly prefix + 5 digits + ".dat", no sign or whitespace; nullopt otherwise
+std::optional<unsigned> dat_file_number(const std::string& name, std::string_view prefix);
+
 // XOR-decodes buffer in-place using rolling key. No-op if key empty.
 void xor_decode(std::vector<uint8_t>& data, const std::vector<uint8_t>& key);
 
+// XOR-decodes a sub range of a file in-place, file_offset is the position of
+// data[0] in the file so the rolling key lines up. Works a register of
+// keystream at a time (SSE2/AVX2 when available). No-op if key empty.
+void xor_decode(std::span<uint8_t> data, const std::vector<uint8_t>& key,
+                uint64_t file_offset);
+
 class Secp256k1Context {
 public:
     // Get global shared context
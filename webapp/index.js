@@ -98,6 +98,89 @@ app.post("/api/analyze", async (req, res) => {
   }
 });
 
+// Server-side bitcoind blocks directory. When set, /api/analyze-block can take
+// { file, block_hash } instead of uploads and reads only that block's records,
+// found through an offset sidecar (built by --build-index on first use)
+const BLOCKS_DIR = process.env.BLOCKS_DIR;
+const BLOCKS_INDEX_DIR =
+  process.env.BLOCKS_INDEX_DIR || path.join(__dirname, "tmp", "index");
+
+const analyzerPath = path.join(__dirname, "analyzer");
+
+function runAnalyzer(args) {
+  return new Promise((resolve) => {
+    const child = spawn(analyzerPath, args);
+
+    let stderrData = "";
+    child.stderr.on("data", (d) => (stderrData += d.toString()));
+    child.on("error", (err) => resolve({ code: -1, stderrData: err.message }));
+    child.on("close", (code) => resolve({ code, stderrData }));
+  });
+}
+
+// Offset sidecar of one blk/rev pair, written once and reused afterwards
+async function ensureOffsetIndex(blkPath, revPath, xorPath, num) {
+  const indexPath = path.join(BLOCKS_INDEX_DIR, `blk${num}.idx`);
+  try {
+    await fs.access(indexPath);
+    return { indexPath };
+  } catch {}
+
+  await fs.mkdir(BLOCKS_INDEX_DIR, { recursive: true });
+  const tmpPath = `${indexPath}.${crypto.randomUUID()}.tmp`;
+  const { code, stderrData } = await runAnalyzer([
+    "--build-index",
+    blkPath,
+    revPath,
+    xorPath,
+    tmpPath,
+  ]);
+  if (code !== 0) {
+    await fs.unlink(tmpPath).catch(() => {});
+    return { error: stderrData || "Building the offset index failed" };
+  }
+  await fs.rename(tmpPath, indexPath);
+  return { indexPath };
+}
+
+// Block analyzer arguments for a block of the server-side blocks directory
+async function blocksDirArgs(body) {
+  const { file, block_hash: blockHash } = body ?? {};
+  const match = typeof file === "string" && /^blk(\d{5})\.dat$/.exec(file);
+  if (!match || typeof blockHash !== "string" || !/^[0-9a-fA-F]{64}$/.test(blockHash)) {
+    return {
+      status: 400,
+      error: {
+        code: "INVALID_ARGS",
+        message: "file (blkNNNNN.dat) and block_hash (64 hex chars) are required",
+      },
+    };
+  }
+
+  const num = match[1];
+  const blkPath = path.join(BLOCKS_DIR, `blk${num}.dat`);
+  const revPath = path.join(BLOCKS_DIR, `rev${num}.dat`);
+  const xorPath = path.join(BLOCKS_DIR, "xor.dat");
+  for (const f of [blkPath, revPath, xorPath]) {
+    try {
+      await fs.access(f);
+    } catch {
+      return {
+        status: 404,
+        error: { code: "FILE_NOT_FOUND", message: `Not in blocks dir: ${path.basename(f)}` },
+      };
+    }
+  }
+
+  const { indexPath, error } = await ensureOffsetIndex(blkPath, revPath, xorPath, num);
+  if (error) {
+    return { status: 500, error: { code: "INDEX_FAILED", message: error } };
+  }
+  return {
+    args: ["--block-at", blkPath, revPath, xorPath, blockHash.toLowerCase(), "--index", indexPath],
+  };
+}
+
 app.post(
   "/api/analyze-block",
   upload.fields([
@@ -109,69 +192,74 @@ app.post(
     const blkFile = req.files?.blk?.[0];
     const revFile = req.files?.rev?.[0];
     const xorFile = req.files?.xor?.[0];
+    const uploads = [blkFile, revFile, xorFile].filter(Boolean);
+    const removeUploads = () =>
+      Promise.all(uploads.map((f) => fs.unlink(f.path).catch(() => {})));
+
+    let args;
+    if (blkFile && revFile && xorFile) {
+      // Optional record offsets: only that one block is read and parsed
+      const { blk_offset: blkOffset, rev_offset: revOffset } = req.body ?? {};
+      const isOffset = (v) => typeof v === "string" && /^\d+$/.test(v);
 
-    if (!blkFile || !revFile || !xorFile) {
+      args =
+        isOffset(blkOffset) && isOffset(revOffset)
+          ? ["--block-at", blkFile.path, revFile.path, xorFile.path, blkOffset, revOffset]
+          : ["--block", blkFile.path, revFile.path, xorFile.path];
+    } else if (BLOCKS_DIR && uploads.length === 0) {
+      const resolved = await blocksDirArgs(req.body);
+      if (resolved.error) {
+        return res.status(resolved.status).json({ ok: false, error: resolved.error });
+      }
+      args = resolved.args;
+    } else {
+      await removeUploads();
       return res.status(400).json({
         ok: false,
         error: {
           code: "MISSING_FILES",
-          message: "blk, rev, and xor files are all required",
+          message: BLOCKS_DIR
+            ? "upload blk, rev, and xor files, or give file and block_hash from the blocks dir"
+            : "blk, rev, and xor files are all required",
         },
       });
     }
 
-    const outDir = path.join(__dirname, "out"); // ← moved here, top of handler
-
-    const analyzerPath = path.join(__dirname, "analyzer");
+    const outDir = path.join(__dirname, "out");
     await fs.rm(outDir, { recursive: true, force: true });
     await fs.mkdir(outDir, { recursive: true });
 
-    const child = spawn(analyzerPath, [
-      "--block",
-      blkFile.path,
-      revFile.path,
-      xorFile.path,
-    ]);
+    const { code, stderrData } = await runAnalyzer(args);
+    await removeUploads();
 
-    let stderrData = "";
-    child.stderr.on("data", (d) => (stderrData += d.toString()));
-
-    child.on("close", async (code) => {
-      await Promise.all([
-        fs.unlink(blkFile.path).catch(() => {}),
-        fs.unlink(revFile.path).catch(() => {}),
-        fs.unlink(xorFile.path).catch(() => {}),
-      ]);
+    if (code !== 0) {
+      return res.status(500).json({
+        ok: false,
+        error: {
+          code: "BLOCK_PARSE_FAILED",
+          message: stderrData || "Analyzer exited with error",
+        },
+      });
+    }
 
-      if (code !== 0) {
-        return res.status(500).json({
-          ok: false,
-          error: {
-            code: "BLOCK_PARSE_FAILED",
-            message: stderrData || "Analyzer exited with error",
-          },
-        });
-      }
+    try {
+      const files = await fs.readdir(outDir);
+      const jsonFiles = files.filter((f) => f.endsWith(".json"));
+      const results = await Promise.all(
+        jsonFiles.map(async (f) => {
+          const content = await fs.readFile(path.join(outDir, f), "utf8");
+          return JSON.parse(content);
+        }),
+      );
 
-      try {
-        const files = await fs.readdir(outDir);
-        const jsonFiles = files.filter((f) => f.endsWith(".json"));
-        const results = await Promise.all(
-          jsonFiles.map(async (f) => {
-            const content = await fs.readFile(path.join(outDir, f), "utf8");
-            return JSON.parse(content);
-          }),
-        );
-
-        if (results.length === 1) return res.status(200).json(results[0]);
-        return res.status(200).json({ ok: true, blocks: results });
-      } catch (err) {
-        return res.status(500).json({
-          ok: false,
-          error: { code: "READ_OUTPUT_FAILED", message: err.message },
-        });
-      }
-    });
+      if (results.length === 1) return res.status(200).json(results[0]);
+      return res.status(200).json({ ok: true, blocks: results });
+    } catch (err) {
+      return res.status(500).json({
+        ok: false,
+        error: { code: "READ_OUTPUT_FAILED", message: err.message },
+      });
+    }
   },
 );
 